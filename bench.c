@@ -0,0 +1,275 @@
+// bench.c
+// Microbenchmarks for the memory manager and linked list hot paths.
+// Built by "make bench", run by "make run_bench". Output is CSV on
+// stdout (benchmark,param,metric,value,git_sha,git_date) so numbers can
+// be tracked per commit; human-readable notes go to stderr.
+#include "memory_manager.h"
+#include "linked_list.h"
+#include "common_defs.h"
+#include "gitdata.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_SIZE (64 * 1024 * 1024)
+#define LAT_SAMPLES 100000
+#define THROUGHPUT_OPS 200000
+#define FRAG_BLOCKS 20000
+#define LIST_NODES_PER_THREAD 4000
+#define LIST_SEARCHES 2000
+
+static const int thread_counts[] = {1, 2, 4, 8, 16, 32};
+#define NUM_THREAD_COUNTS (sizeof(thread_counts) / sizeof(thread_counts[0]))
+
+// Nanosecond timestamp from the monotonic clock
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// One CSV row; every benchmark funnels through here
+static void emit(const char *benchmark, int param, const char *metric, double value)
+{
+    printf("%s,%d,%s,%.1f,%s,%s\n", benchmark, param, metric, value, git_sha, git_date);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Pick the q'th percentile from a sorted sample array
+static double percentile(uint64_t *sorted, size_t n, double q)
+{
+    size_t idx = (size_t)(q * (double)(n - 1));
+    return (double)sorted[idx];
+}
+
+// ---- Allocator latency distribution -------------------------------------
+// Times every mem_alloc and mem_free of a mixed small-size workload and
+// reports p50/p99 for each, which is where thread-cache or free-list
+// regressions show up first.
+static void bench_alloc_latency(void)
+{
+    static uint64_t alloc_ns[LAT_SAMPLES];
+    static uint64_t free_ns[LAT_SAMPLES];
+    static void *ptrs[LAT_SAMPLES];
+
+    mem_init(POOL_SIZE);
+    srand(42);
+
+    for (int i = 0; i < LAT_SAMPLES; ++i)
+    {
+        size_t size = 16 + (size_t)(rand() % 241); // 16..256 bytes
+        uint64_t t0 = now_ns();
+        ptrs[i] = mem_alloc(size);
+        alloc_ns[i] = now_ns() - t0;
+        if (!ptrs[i])
+        {
+            fprintf(stderr, "bench_alloc_latency: pool exhausted at %d\n", i);
+            break;
+        }
+    }
+    for (int i = 0; i < LAT_SAMPLES; ++i)
+    {
+        uint64_t t0 = now_ns();
+        mem_free(ptrs[i]);
+        free_ns[i] = now_ns() - t0;
+    }
+    mem_deinit();
+
+    qsort(alloc_ns, LAT_SAMPLES, sizeof(uint64_t), cmp_u64);
+    qsort(free_ns, LAT_SAMPLES, sizeof(uint64_t), cmp_u64);
+    emit("alloc_latency", 0, "p50_ns", percentile(alloc_ns, LAT_SAMPLES, 0.50));
+    emit("alloc_latency", 0, "p99_ns", percentile(alloc_ns, LAT_SAMPLES, 0.99));
+    emit("free_latency", 0, "p50_ns", percentile(free_ns, LAT_SAMPLES, 0.50));
+    emit("free_latency", 0, "p99_ns", percentile(free_ns, LAT_SAMPLES, 0.99));
+}
+
+// ---- Multi-threaded allocator throughput --------------------------------
+// Every thread hammers mem_alloc/mem_free pairs; the barrier lines the
+// threads up so the clock only covers the contended phase.
+typedef struct
+{
+    my_barrier_t *barrier;
+    unsigned seed;
+} alloc_worker_arg;
+
+static void *alloc_worker(void *arg)
+{
+    alloc_worker_arg *wa = arg;
+    unsigned seed = wa->seed;
+    my_barrier_wait(wa->barrier);
+    for (int i = 0; i < THROUGHPUT_OPS; ++i)
+    {
+        size_t size = 16 + (size_t)(rand_r(&seed) % 241);
+        void *ptr = mem_alloc(size);
+        if (ptr)
+            mem_free(ptr);
+    }
+    return NULL;
+}
+
+static void bench_alloc_throughput(void)
+{
+    for (size_t t = 0; t < NUM_THREAD_COUNTS; ++t)
+    {
+        int threads = thread_counts[t];
+        pthread_t tid[32];
+        alloc_worker_arg args[32];
+        my_barrier_t barrier;
+
+        mem_init(POOL_SIZE);
+        my_barrier_init(&barrier, threads + 1);
+        for (int i = 0; i < threads; ++i)
+        {
+            args[i].barrier = &barrier;
+            args[i].seed = (unsigned)(i * 2654435761u + 1);
+            pthread_create(&tid[i], NULL, alloc_worker, &args[i]);
+        }
+
+        my_barrier_wait(&barrier); // Release the pack together
+        uint64_t t0 = now_ns();
+        for (int i = 0; i < threads; ++i)
+            pthread_join(tid[i], NULL);
+        uint64_t elapsed = now_ns() - t0;
+
+        my_barrier_destroy(&barrier);
+        mem_deinit();
+
+        double ops = (double)threads * THROUGHPUT_OPS;
+        emit("alloc_throughput", threads, "mops_per_s", ops / (double)elapsed * 1000.0);
+    }
+}
+
+// ---- Fragmentation decay ------------------------------------------------
+// Fills the pool with mixed sizes, frees every other block to shatter
+// it, then measures how much allocation slows down in the holes.
+static void bench_fragmentation(void)
+{
+    static void *ptrs[FRAG_BLOCKS];
+    static uint64_t lat[FRAG_BLOCKS / 2];
+
+    mem_init(POOL_SIZE);
+    srand(7);
+    for (int i = 0; i < FRAG_BLOCKS; ++i)
+        ptrs[i] = mem_alloc(32 + (size_t)(rand() % 481)); // 32..512 bytes
+    for (int i = 0; i < FRAG_BLOCKS; i += 2)
+    {
+        mem_free(ptrs[i]);
+        ptrs[i] = NULL;
+    }
+
+    // Allocate back into the checkerboard of holes
+    size_t n = 0;
+    for (int i = 0; i < FRAG_BLOCKS && n < FRAG_BLOCKS / 2; i += 2)
+    {
+        uint64_t t0 = now_ns();
+        void *ptr = mem_alloc(32 + (size_t)(rand() % 225));
+        lat[n++] = now_ns() - t0;
+        if (ptr)
+            mem_free(ptr);
+    }
+    mem_stats_t st;
+    mem_stats(&st);
+    mem_deinit();
+
+    qsort(lat, n, sizeof(uint64_t), cmp_u64);
+    emit("frag_alloc_latency", 0, "p50_ns", percentile(lat, n, 0.50));
+    emit("frag_alloc_latency", 0, "p99_ns", percentile(lat, n, 0.99));
+    emit("frag_alloc_latency", 0, "block_count", (double)st.block_count);
+}
+
+// ---- Linked list scaling ------------------------------------------------
+// Concurrent list_insert by all threads, then concurrent list_search of
+// random values, at each thread count.
+typedef struct
+{
+    my_barrier_t *barrier;
+    Node **head;
+    unsigned seed;
+} list_worker_arg;
+
+static void *list_insert_worker(void *arg)
+{
+    list_worker_arg *wa = arg;
+    unsigned seed = wa->seed;
+    my_barrier_wait(wa->barrier);
+    for (int i = 0; i < LIST_NODES_PER_THREAD; ++i)
+        list_insert(wa->head, (uint16_t)(rand_r(&seed) % 50000));
+    return NULL;
+}
+
+static void *list_search_worker(void *arg)
+{
+    list_worker_arg *wa = arg;
+    unsigned seed = wa->seed;
+    my_barrier_wait(wa->barrier);
+    for (int i = 0; i < LIST_SEARCHES; ++i)
+        list_search(wa->head, (uint16_t)(rand_r(&seed) % 50000));
+    return NULL;
+}
+
+static void bench_list(void)
+{
+    for (size_t t = 0; t < NUM_THREAD_COUNTS; ++t)
+    {
+        int threads = thread_counts[t];
+        pthread_t tid[32];
+        list_worker_arg args[32];
+        my_barrier_t barrier;
+        Node *head = NULL;
+
+        list_init(&head, POOL_SIZE);
+
+        // Phase 1: concurrent inserts
+        my_barrier_init(&barrier, threads + 1);
+        for (int i = 0; i < threads; ++i)
+        {
+            args[i].barrier = &barrier;
+            args[i].head = &head;
+            args[i].seed = (unsigned)(i * 40503u + 3);
+            pthread_create(&tid[i], NULL, list_insert_worker, &args[i]);
+        }
+        my_barrier_wait(&barrier);
+        uint64_t t0 = now_ns();
+        for (int i = 0; i < threads; ++i)
+            pthread_join(tid[i], NULL);
+        uint64_t insert_ns = now_ns() - t0;
+        my_barrier_destroy(&barrier);
+
+        // Phase 2: concurrent searches over the built-up list
+        my_barrier_init(&barrier, threads + 1);
+        for (int i = 0; i < threads; ++i)
+            pthread_create(&tid[i], NULL, list_search_worker, &args[i]);
+        my_barrier_wait(&barrier);
+        t0 = now_ns();
+        for (int i = 0; i < threads; ++i)
+            pthread_join(tid[i], NULL);
+        uint64_t search_ns = now_ns() - t0;
+        my_barrier_destroy(&barrier);
+
+        list_cleanup(&head);
+
+        double inserts = (double)threads * LIST_NODES_PER_THREAD;
+        double searches = (double)threads * LIST_SEARCHES;
+        emit("list_insert", threads, "kops_per_s", inserts / (double)insert_ns * 1000000.0);
+        emit("list_search", threads, "kops_per_s", searches / (double)search_ns * 1000000.0);
+    }
+}
+
+int main(void)
+{
+    fprintf(stderr, "Running allocator and list microbenchmarks...\n");
+    printf("benchmark,param,metric,value,git_sha,git_date\n");
+    bench_alloc_latency();
+    bench_alloc_throughput();
+    bench_fragmentation();
+    bench_list();
+    fprintf(stderr, "Done.\n");
+    return 0;
+}
@@ -5,12 +5,26 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include "memory_manager.h"
+
 char tmpbuff[1024];
 unsigned long tmppos = 0;
 unsigned long tmpallocs = 0;
 
-void *memset(void*,int,size_t);
-void *memmove(void *to, const void *from, size_t size);
+/* Arena mode: with CM2_ARENA set in the environment (to a pool size in
+ * bytes, or any non-number for the 64 MB default), malloc/free/realloc/
+ * calloc/memalign dispatch into the pool allocator instead of the real
+ * heap, so a preloaded child process gets arena behavior without code
+ * changes. arena_busy is the reentrancy guard: the pool allocator's own
+ * metadata allocations re-enter these hooks and must go to the real
+ * heap, exactly like the tmpbuff path covers dlsym's bootstrap mallocs.
+ * Pointers that predate the arena (or come from the real heap some
+ * other way) are quietly ignored by mem_free, so freeing them leaks
+ * rather than crashes. */
+static int arena_mode = 0;
+static __thread int arena_busy = 0;
+
+#define ARENA_DEFAULT_SIZE (64UL * 1024 * 1024)
 
 /*=========================================================
  * interception points
@@ -24,6 +38,107 @@ static void * (*myfn_memalign)(size_t blocksize, size_t bytes);
 static void * (*myfn_mmap)(void *ptr,  size_t length, int prot, int flags, int fd, off_t offset);
 static int (*myfn_munmap)(void *ptr, size_t length);
 
+/*=========================================================
+ * event log
+ *
+ * The old logging did sprintf plus a write(2) syscall inside every
+ * intercepted call, which costs microseconds per allocation and drowns
+ * the workload being profiled. Events now go into a per-thread ring of
+ * fixed binary records (no formatting, no syscall, no locks on the hot
+ * path), optionally keeping only 1-in-N events (CM2_SAMPLE=N). Each
+ * ring holds the most recent CM2_RING_CAP kept events and is flushed
+ * with one write when its thread exits (and the main thread's at
+ * process exit) to the file named by CM2_LOG, or fd 1 by default.
+ * Threads still alive at process exit lose their unflushed tails.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+
+enum { CM2_OP_MALLOC = 1, CM2_OP_FREE, CM2_OP_REALLOC, CM2_OP_CALLOC,
+       CM2_OP_MEMALIGN, CM2_OP_MMAP, CM2_OP_MUNMAP };
+
+typedef struct {
+  uint32_t op;    /* one of the CM2_OP_* codes */
+  uint32_t tid;   /* the recording thread */
+  uint64_t size;  /* request size in bytes */
+  uint64_t ptr;   /* input pointer (free/realloc/munmap), else 0 */
+  uint64_t result;/* returned pointer, else 0 */
+} cm2_record;
+
+#define CM2_RING_CAP 4096
+
+typedef struct {
+  cm2_record rec[CM2_RING_CAP];
+  unsigned long seen;  /* every event this thread saw (drives sampling) */
+  unsigned long kept;  /* events actually recorded; ring wraps past CAP */
+  uint32_t tid;
+} cm2_ring;
+
+static int log_fd = 1;              /* where flushed rings go */
+static unsigned long sample_n = 1;  /* keep 1 event in sample_n */
+static pthread_key_t ring_key;      /* flushes a thread's ring at its exit */
+static __thread cm2_ring *my_ring = NULL;
+
+/* Write out a ring's kept records, oldest first, in one or two writes */
+static void ring_flush(void *arg)
+{
+  cm2_ring *ring = arg;
+  unsigned long kept = ring->kept;
+  if (kept > CM2_RING_CAP)
+    {
+      unsigned long start = kept % CM2_RING_CAP;
+      write(log_fd, &ring->rec[start], (CM2_RING_CAP - start) * sizeof(cm2_record));
+      write(log_fd, &ring->rec[0], start * sizeof(cm2_record));
+    }
+  else if (kept > 0)
+    write(log_fd, &ring->rec[0], kept * sizeof(cm2_record));
+  ring->kept = 0;
+  my_ring = NULL; /* the destructor runs on the exiting thread itself */
+  myfn_free(ring);
+}
+
+static void main_ring_flush(void)
+{
+  if (my_ring)
+    {
+      ring_flush(my_ring);
+      my_ring = NULL;
+    }
+}
+
+/* Record one event in the calling thread's ring; no syscall, no lock */
+static void cm2_log(uint32_t op, uint64_t size, void *ptr, void *result)
+{
+  if (!myfn_calloc)
+    return; /* events before init has run have nowhere safe to go */
+  cm2_ring *ring = my_ring;
+  if (!ring)
+    {
+      /* First event on this thread; the ring comes from the real heap
+       * so arena teardown can never pull it out from under us */
+      ring = myfn_calloc(1, sizeof(cm2_ring));
+      if (!ring)
+        return;
+      ring->tid = (uint32_t)syscall(SYS_gettid);
+      my_ring = ring;
+      pthread_setspecific(ring_key, ring);
+    }
+  if (ring->seen++ % sample_n)
+    return;
+  cm2_record *r = &ring->rec[ring->kept++ % CM2_RING_CAP];
+  r->op     = op;
+  r->tid    = ring->tid;
+  r->size   = size;
+  r->ptr    = (uint64_t)(uintptr_t)ptr;
+  r->result = (uint64_t)(uintptr_t)result;
+}
+
+void *memset(void*,int,size_t);
+void *memmove(void *to, const void *from, size_t size);
 
 static void init(){
   myfn_malloc     = dlsym(RTLD_NEXT, "malloc");
@@ -34,11 +149,41 @@ static void init(){
   myfn_mmap       = dlsym(RTLD_NEXT, "mmap");
   myfn_munmap     = dlsym(RTLD_NEXT, "munmap");
   
-  if (!myfn_malloc || !myfn_free || !myfn_calloc || !myfn_realloc || !myfn_memalign || !myfn_mmap || !myfn_munmap ) 
+  if (!myfn_malloc || !myfn_free || !myfn_calloc || !myfn_realloc || !myfn_memalign || !myfn_mmap || !myfn_munmap )
     {
       fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
       exit(1);
     }
+
+  /* Logging setup: sampling rate, output destination, flush-at-exit */
+  const char *sample = getenv("CM2_SAMPLE");
+  if (sample && atol(sample) > 0)
+    sample_n = (unsigned long)atol(sample);
+  const char *logfile = getenv("CM2_LOG");
+  if (logfile)
+    {
+      int fd = open(logfile, O_WRONLY | O_CREAT | O_APPEND, 0644);
+      if (fd >= 0)
+	log_fd = fd;
+    }
+  pthread_key_create(&ring_key, ring_flush);
+  atexit(main_ring_flush);
+
+  /* Set up the pool if arena mode was requested; the guard keeps the
+   * pool's own metadata allocations on the real heap */
+  const char *arena = getenv("CM2_ARENA");
+  if (arena)
+    {
+      size_t size = (size_t)atol(arena);
+      if (size == 0)
+	size = ARENA_DEFAULT_SIZE;
+      arena_busy = 1;
+      mem_init(size);
+      mem_set_auto_grow(1); /* a child process must not die on pool exhaustion */
+      arena_busy = 0;
+      arena_mode = 1;
+      fprintf(stdout, "jcheck: arena mode with a %lu byte pool\n", (unsigned long)size);
+    }
 }
 
 void *malloc(size_t size){
@@ -66,10 +211,16 @@ void *malloc(size_t size){
     }
   }
 
-  void *ptr = myfn_malloc(size);
-  char buffer[50];
-  int len=sprintf(buffer,"rMALLOc (%ld) at %p\n",size,ptr);
-  write(1,buffer,len);
+  void *ptr;
+  if (arena_mode && !arena_busy)
+    {
+      arena_busy = 1;
+      ptr = mem_alloc(size);
+      arena_busy = 0;
+    }
+  else
+    ptr = myfn_malloc(size);
+  cm2_log(CM2_OP_MALLOC, size, NULL, ptr);
   return ptr;
 }
 
@@ -80,19 +231,22 @@ void free(void *ptr){
   
   if (ptr >= (void*) tmpbuff && ptr <= (void*)(tmpbuff + tmppos))
     fprintf(stdout, "freeing temp memory\n");
+  else if (arena_mode && !arena_busy)
+    {
+      /* mem_free ignores pointers outside the pool, so a stray real-heap
+       * pointer leaks instead of corrupting anything */
+      arena_busy = 1;
+      mem_free(ptr);
+      arena_busy = 0;
+    }
   else
     myfn_free(ptr);
 
-  char buffer[50];
-  int len=sprintf(buffer,"rFREE at %p\n",ptr);
-  write(1,buffer,len);
+  cm2_log(CM2_OP_FREE, 0, ptr, NULL);
 }
 
 void *realloc(void *ptr, size_t size)
 {
-  char buffer[70];
-  int len=sprintf(buffer,"rREALLOC-> (%ld) at %p \n",size,ptr);
-  write(1,buffer,len);
     if (myfn_malloc == NULL)
     {
         void *nptr = malloc(size);
@@ -104,11 +258,17 @@ void *realloc(void *ptr, size_t size)
         return nptr;
     }
 
-    void *nptr = myfn_realloc(ptr, size);
-
+    void *nptr;
+    if (arena_mode && !arena_busy)
+      {
+        arena_busy = 1;
+        nptr = mem_resize(ptr, size);
+        arena_busy = 0;
+      }
+    else
+      nptr = myfn_realloc(ptr, size);
 
-    len=sprintf(buffer,"rREALLOC (%ld) at %p -> %p\n",size,ptr,nptr);
-    write(1,buffer,len);
+    cm2_log(CM2_OP_REALLOC, size, ptr, nptr);
     return nptr;
 }
 
@@ -122,23 +282,37 @@ void *calloc(size_t nmemb, size_t size)
         return ptr;
     }
 
-    void *ptr = myfn_calloc(nmemb, size);
+    void *ptr;
+    if (arena_mode && !arena_busy)
+      {
+        /* mem_calloc skips the memset when the block comes from pages
+         * the pool knows are still zero */
+        arena_busy = 1;
+        ptr = mem_calloc(nmemb, size);
+        arena_busy = 0;
+      }
+    else
+      ptr = myfn_calloc(nmemb, size);
+
+    cm2_log(CM2_OP_CALLOC, nmemb * size, NULL, ptr);
 
-    char buffer[70];
-    int len=sprintf(buffer,"rCALLOC (%ld,%ld) \n",nmemb, size);
-    write(1,buffer,len);
-    
     return ptr;
 }
 
 void *memalign(size_t blocksize, size_t bytes)
 {
-    void *ptr = myfn_memalign(blocksize, bytes);
+    void *ptr;
+    if (arena_mode && !arena_busy)
+      {
+        arena_busy = 1;
+        ptr = mem_alloc_aligned(bytes, blocksize);
+        arena_busy = 0;
+      }
+    else
+      ptr = myfn_memalign(blocksize, bytes);
+
+    cm2_log(CM2_OP_MEMALIGN, bytes, NULL, ptr);
 
-    char buffer[70];
-    int len=sprintf(buffer,"rMEMALING (%ld, %ld) @ %p\n",blocksize, bytes,ptr);
-    write(1,buffer,len);
-    
     return ptr;
 }
 
@@ -167,24 +341,17 @@ void *mmap(void *ptr,  size_t length, int prot, int flags, int fd, off_t offset)
     }
   }
   void *ptr2 = myfn_mmap(ptr, length, prot, flags, fd, offset);
-    
-  char buffer[70];
-  int len=sprintf(buffer,"rMMAP (%ld) at %p\n", length, ptr2);
-  write(1,buffer,len);
-  
+
+  cm2_log(CM2_OP_MMAP, length, ptr, ptr2);
+
   return ptr2;
 }
 
 
 int munmap(void *ptr, size_t length){
-  char buffer[70];
-  int len=sprintf(buffer,"rMUNMMAP-> (%p,%ld) => \n",ptr, length);
-  write(1,buffer,len);
-  
   int resp=myfn_munmap(ptr, length);
 
-  len=sprintf(buffer,"rMUNMMAP (%p,%ld) => %d\n",ptr, length, resp);
-  write(1,buffer,len);
+  cm2_log(CM2_OP_MUNMAP, length, ptr, NULL);
 
   return resp;
 }
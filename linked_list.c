@@ -1,36 +1,369 @@
 #include "linked_list.h"
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-static pthread_mutex_t list_mutex = PTHREAD_MUTEX_INITIALIZER; // The global lock
- 
-// Shortcuts for locking/unlocking the mutex
-#define LOCK()   pthread_mutex_lock(&list_mutex)
-#define UNLOCK() pthread_mutex_unlock(&list_mutex)
+// The global lock is a read-write lock: every mutating operation takes
+// the write side (exclusive, exactly what the old mutex gave them), and
+// the read-only paths that still need the lock — the sorted-search lane
+// lookup and the exact count — share the read side, so they no longer
+// serialize against each other. Plain searches and displays take no
+// lock at all (see the epoch machinery below).
+static pthread_rwlock_t list_mutex = PTHREAD_RWLOCK_INITIALIZER;
+
+// Shortcuts for the lock's two sides
+#define LOCK()   pthread_rwlock_wrlock(&list_mutex)
+#define RDLOCK() pthread_rwlock_rdlock(&list_mutex)
+#define UNLOCK() pthread_rwlock_unlock(&list_mutex)
+
+// Readers traverse without any lock: writers publish next pointers with a
+// release store and readers follow them with acquire loads, so a reader
+// always sees a node fully initialized before it sees the link to it.
+#define NEXT_STORE(dst, val) __atomic_store_n(&(dst), (val), __ATOMIC_RELEASE)
+#define NEXT_LOAD(src)       __atomic_load_n(&(src), __ATOMIC_ACQUIRE)
+
+// Cached tail so append does not re-walk the list every time. The cache
+// remembers which head it belongs to, since the API passes bare Node**
+// handles; operations on another list simply fall back to walking once
+// and then own the cache. Only touched while the write side is held.
+static Node **tail_owner = NULL; // The head pointer the cached tail belongs to
+static Node  *tail_node  = NULL; // Last node of that list, or NULL if unknown
+
+// Node pool: nodes come from slabs carved out of the memory manager in
+// one batch and recycle through a freelist with their mutexes kept
+// initialized, so the insert/delete hot paths skip both the allocator
+// and the mutex init/destroy churn. Falls back to single allocations
+// when the pool is too tight for a whole slab. Slab nodes are handed
+// out in ascending address order, so a sequentially built list walks
+// forward through memory and the hardware prefetcher can follow it.
+#define NODE_SLAB_COUNT 64
+
+static Node *node_freelist = NULL; // Recycled nodes, linked through next
+static pthread_mutex_t node_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// The memory pool this list's allocations come from. NULL means the
+// classic global pool; list_init_from binds a caller-created pool
+// instead, which list_cleanup then destroys in one go without touching
+// the global pool other subsystems may be using. The mem_*_from calls
+// fall back to the global pool on NULL, so the routing is uniform.
+static mem_pool_t *list_pool = NULL;
+
+// Take a ready-to-use node (mutex already initialized) from the pool
+static Node *node_pool_get(void) {
+    pthread_mutex_lock(&node_pool_mutex);
+
+    // Step 1: Refill the freelist with a whole slab if it ran dry
+    if (!node_freelist) {
+        void *slab[NODE_SLAB_COUNT];
+        if (mem_alloc_batch_from(list_pool, sizeof(Node), NODE_SLAB_COUNT, slab) == NODE_SLAB_COUNT) {
+            // Push in reverse so the freelist pops lowest address first
+            for (int i = NODE_SLAB_COUNT - 1; i >= 0; --i) {
+                Node *nd = (Node *)slab[i];
+                pthread_mutex_init(&nd->lock, NULL);
+                nd->next = node_freelist;
+                node_freelist = nd;
+            }
+        }
+    }
+
+    // Step 2: Pop a recycled node if there is one
+    Node *n = node_freelist;
+    if (n)
+        node_freelist = n->next;
+    pthread_mutex_unlock(&node_pool_mutex);
+    if (n)
+        return n;
+
+    // Step 3: Pool too tight for a slab; take one node the plain way
+    n = (Node *)mem_alloc_from(list_pool, sizeof(Node));
+    if (n)
+        pthread_mutex_init(&n->lock, NULL);
+    return n;
+}
+
+// Give a node back to the pool; its mutex stays initialized for reuse
+static void node_pool_put(Node *n) {
+    pthread_mutex_lock(&node_pool_mutex);
+    n->next = node_freelist;
+    node_freelist = n;
+    pthread_mutex_unlock(&node_pool_mutex);
+}
+
+// Drop every pooled node; the memory manager is about to be torn down
+static void node_pool_drain(void) {
+    pthread_mutex_lock(&node_pool_mutex);
+    for (Node *n = node_freelist; n; n = n->next)
+        pthread_mutex_destroy(&n->lock);
+    node_freelist = NULL;
+    pthread_mutex_unlock(&node_pool_mutex);
+}
+
+// Epoch-based read protection: lock-free readers announce themselves in
+// the current epoch's counter, and a deleter flips the epoch and waits
+// until the old epoch drains before a removed node may be recycled. An
+// unlinked node therefore keeps its next pointer intact (still aimed
+// into the list) until no reader can possibly be standing on it, which
+// is what makes lock-free traversal safe. Readers never wait; only the
+// deleter does, and deletes already serialize on list_mutex.
+static unsigned long reader_count[2]; // Active readers per epoch (atomic)
+static unsigned long reader_epoch;    // Current epoch, alternates 0/1 (atomic)
+
+// Enter the read side; returns the epoch slot to leave with read_exit
+static unsigned read_enter(void) {
+    while (1) {
+        unsigned e = __atomic_load_n(&reader_epoch, __ATOMIC_ACQUIRE) & 1;
+        __atomic_fetch_add(&reader_count[e], 1, __ATOMIC_ACQ_REL);
+
+        // Recheck: if the epoch flipped under us, back out and retry so
+        // the deleter never waits on a reader that has not started yet
+        if ((__atomic_load_n(&reader_epoch, __ATOMIC_ACQUIRE) & 1) == e)
+            return e;
+        __atomic_fetch_sub(&reader_count[e], 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+// Leave the read side
+static void read_exit(unsigned e) {
+    __atomic_fetch_sub(&reader_count[e], 1, __ATOMIC_ACQ_REL);
+}
+
+// Wait out every reader that may have seen a node just unlinked. Flips
+// the epoch and spins until the old epoch's counter drains; readers that
+// arrive after the flip land in the new epoch and start from the list
+// head, where the unlinked node is no longer reachable.
+static void wait_for_readers(void) {
+    unsigned e = __atomic_load_n(&reader_epoch, __ATOMIC_ACQUIRE) & 1;
+    __atomic_store_n(&reader_epoch, e ^ 1, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&reader_count[e], __ATOMIC_ACQUIRE) != 0)
+        sched_yield();
+}
+
+// Look up (or rebuild) the cached tail for this list (lock must be held)
+static Node *get_tail(Node **head) {
+    // Step 1: Reuse the cache when it is ours and still points at the end
+    if (tail_owner == head && tail_node && tail_node->next == NULL)
+        return tail_node;
+
+    // Step 2: Otherwise walk once and take ownership of the cache
+    Node *cur = *head;
+    while (cur && cur->next)
+        cur = cur->next;
+    tail_owner = head;
+    tail_node  = cur;
+    return cur;
+}
+
+// Cached element count, maintained by the insert and delete paths so
+// list_count_nodes is an O(1) read instead of a full walk. Keyed to the
+// owning head pointer like the tail cache. list_insert_after cannot
+// know which list it extends (it only sees a node), so it invalidates
+// the cache; the next count rescans once under the lock and re-adopts.
+static Node **count_owner = NULL; // Head pointer the count belongs to
+static long   count_value = 0;    // Element count of that list (atomic)
+
+// Bump the cached count if it tracks this list (callers may be off-lock)
+static void count_adjust(Node **head, long delta) {
+    if (__atomic_load_n(&count_owner, __ATOMIC_ACQUIRE) == head)
+        __atomic_fetch_add(&count_value, delta, __ATOMIC_RELAXED);
+}
+
+// Sorted mode: when a list is initialized with list_init_sorted, inserts
+// keep the nodes in ascending data order and searches use an express
+// lane — an array holding every EXPRESS_STRIDE'th node, kept in the
+// memory pool. A search binary-searches the lane for the closest sample
+// below the key and scans at most a stride's worth of nodes from there.
+// The Node layout is public API, so express pointers live beside the
+// list rather than in per-node towers; the lane is rebuilt lazily once
+// enough inserts or a delete have made it stale. Like the tail cache it
+// is keyed to the owning head pointer. Writes to the lane happen only
+// under the write side of list_mutex; readers may consult it sharing
+// the read side.
+#define EXPRESS_STRIDE 64
+
+static Node **sorted_owner  = NULL; // Head pointer of the sorted list, if any
+static Node **express       = NULL; // Every EXPRESS_STRIDE'th node, ascending
+static size_t express_len   = 0;    // Samples currently in the lane
+static size_t express_cap   = 0;    // Samples the array has room for
+static size_t express_stale = 0;    // Inserts since the lane was last rebuilt
+
+// Throw the lane away (lock must be held); the next rebuild starts fresh
+static void express_drop(void) {
+    if (express)
+        mem_free_from(list_pool, express);
+    express       = NULL;
+    express_len   = 0;
+    express_cap   = 0;
+    express_stale = 0;
+}
+
+// Resample the whole list into the lane (lock must be held). Costs one
+// walk, but runs only after ~list-length/EXPRESS_STRIDE inserts, so the
+// amortized price per insert stays constant.
+static void express_rebuild(Node **head) {
+    express_len   = 0;
+    express_stale = 0;
+    size_t i = 0;
+    for (Node *cur = *head; cur; cur = cur->next, ++i) {
+        if (i % EXPRESS_STRIDE != 0)
+            continue;
+        if (express_len == express_cap) {
+            size_t cap = express_cap ? express_cap * 2 : 64;
+            Node **grown = express
+                ? (Node **)mem_resize_from(list_pool, express, cap * sizeof(Node *))
+                : (Node **)mem_alloc_from(list_pool, cap * sizeof(Node *));
+            if (!grown)
+                return; // Lane stays short; searches just scan further
+            express     = grown;
+            express_cap = cap;
+        }
+        express[express_len++] = cur;
+    }
+}
+
+// Has the lane gone stale enough to be worth rebuilding?
+static int express_is_stale(void) {
+    return express_stale >= express_len + EXPRESS_STRIDE;
+}
+
+// Rebuild the lane if it has gone stale enough to be worth it (write
+// side of the lock must be held; the rebuild mutates the lane)
+static void express_freshen(Node **head) {
+    if (express_is_stale())
+        express_rebuild(head);
+}
+
+// Binary-search the lane for the last sample at or below data; returns
+// NULL when the walk should start from the head (lock must be held)
+static Node *express_seek(uint16_t data) {
+    if (express_len == 0 || express[0]->data > data)
+        return NULL;
+    size_t lo = 0, hi = express_len - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (express[mid]->data <= data)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return express[lo];
+}
+
+// Insert into a sorted list, keeping ascending order (lock must be held)
+static void sorted_insert(Node **head, Node *n) {
+    // Step 1: New smallest value (or empty list) becomes the head
+    if (!*head || (*head)->data >= n->data) {
+        n->next = *head;
+        NEXT_STORE(*head, n);
+        if (!n->next) {
+            tail_owner = head;
+            tail_node  = n;
+        }
+    } else {
+        // Step 2: Skip ahead via the lane, then walk to the predecessor
+        express_freshen(head);
+        Node *prev = express_seek(n->data);
+        if (!prev)
+            prev = *head;
+        while (prev->next && prev->next->data < n->data)
+            prev = prev->next;
+
+        // Step 3: Splice in after the predecessor
+        n->next = prev->next;
+        NEXT_STORE(prev->next, n);
+        if (!n->next) {
+            tail_owner = head;
+            tail_node  = n;
+        }
+    }
+    ++express_stale;
+}
 
 // Initialize linked list and custom memory pool
 void list_init(Node **head, size_t size){
     // Step 1: Lock the list to avoid race conditions
     LOCK();
+    node_pool_drain(); // No pooled node may outlive its memory pool
+    list_pool = NULL; // Back on the classic global pool
     mem_init(size); // Initialize memory pool
     *head = NULL; // Set list head to NULL since list is empty at start
+    tail_owner = NULL; // Forget any cached tail from an earlier list
+    tail_node  = NULL;
+    sorted_owner = NULL; // Plain append order unless list_init_sorted is used
+    express       = NULL; // The old pool (and the lane in it) is gone
+    express_len   = 0;
+    express_cap   = 0;
+    express_stale = 0;
+    __atomic_store_n(&count_value, 0, __ATOMIC_RELAXED); // Track from empty
+    __atomic_store_n(&count_owner, head, __ATOMIC_RELEASE);
     UNLOCK(); // Unlock the list
 }
 
+// Initialize a list in sorted mode: inserts keep ascending data order
+// and searches take the express lane instead of scanning from the head
+void list_init_sorted(Node **head, size_t size){
+    list_init(head, size);
+    LOCK();
+    sorted_owner = head;
+    UNLOCK();
+}
+
+// Initialize a list on a caller-created pool instead of the global one.
+// Nodes and the express lane then come from that pool, its lock is
+// private to this list, and list_cleanup destroys the whole pool in one
+// go without touching the global pool other subsystems may be using.
+void list_init_from(Node **head, mem_pool_t *pool){
+    LOCK();
+    node_pool_drain(); // Pooled nodes belong to the previous binding
+    list_pool = pool;
+    *head = NULL;
+    tail_owner = NULL;
+    tail_node  = NULL;
+    sorted_owner = NULL;
+    express       = NULL;
+    express_len   = 0;
+    express_cap   = 0;
+    express_stale = 0;
+    __atomic_store_n(&count_value, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&count_owner, head, __ATOMIC_RELEASE);
+    UNLOCK();
+}
+
+// Rebind a list head to nodes already living in the memory pool, by the
+// head node's pool offset. This is the list half of a warm restart: after
+// mem_restore brings the pool back at its old address, the node chain is
+// intact and only the head pointer needs recreating. Every list cache
+// starts cold; the first list_count_nodes rescans once and re-adopts.
+void list_attach(Node **head, size_t offset){
+    LOCK();
+    node_pool_drain(); // Pooled spares would point into the previous life
+    list_pool = NULL; // Snapshots cover the classic global pool
+    *head = (offset == (size_t)-1) ? NULL : mem_ptr_at(offset);
+    tail_owner = NULL;
+    tail_node  = NULL;
+    sorted_owner = NULL; // Sorted mode does not survive a restart
+    express       = NULL;
+    express_len   = 0;
+    express_cap   = 0;
+    express_stale = 0;
+    __atomic_store_n(&count_owner, NULL, __ATOMIC_RELEASE); // Count is unknown
+    UNLOCK();
+}
+
 // Helper to allocate new node
 static Node *new_node(uint16_t data){
-    // Step 1: Allocate memory from memory pool
-    Node *n = (Node *)mem_alloc(sizeof(Node));
+    // Step 1: Take a node from the node pool (its mutex is already set up)
+    Node *n = node_pool_get();
     if (!n)
         return NULL; // Allocation failed
 
     // Step 2: Initialize node data
     n->data = data; // Store the data
     n->next = NULL; // No next node
-
-    // Step 3: Initialize node's individual mutex
-    pthread_mutex_init(&n->lock, NULL);
     return n;
 }
 
@@ -47,21 +380,240 @@ void list_insert(Node **head, uint16_t data){
         return;
     }
 
-    // Step 3: If list is empty, new node becomes head
+    // Step 3: In sorted mode, place the node by value instead of at the end
+    if (sorted_owner == head) {
+        sorted_insert(head, n);
+        count_adjust(head, 1);
+        UNLOCK();
+        return;
+    }
+
+    // Step 4: If list is empty, new node becomes head
     if (*head == NULL) {
-        *head = n;
+        NEXT_STORE(*head, n);
     } else {
-        // Step 4: Otherwise, walk to the end of the list
-        Node *cur = *head;
-        while (cur->next)
-            cur = cur->next;
+        // Step 5: Append after the cached tail; O(1) in the common case.
+        // An insert_after may have extended the list past the cached
+        // tail without the list lock, so couple forward under the node
+        // locks until the true end is reached.
+        Node *tail = get_tail(head);
+        pthread_mutex_lock(&tail->lock);
+        while (tail->next) {
+            Node *nx = tail->next;
+            pthread_mutex_lock(&nx->lock);
+            pthread_mutex_unlock(&tail->lock);
+            tail = nx;
+        }
+        NEXT_STORE(tail->next, n);
+        pthread_mutex_unlock(&tail->lock);
+    }
+
+    // Step 6: Remember the new node as the tail and unlock the list
+    tail_owner = head;
+    tail_node  = n;
+    count_adjust(head, 1);
+    UNLOCK();
+}
 
-        // Step 5: Add the new node at the end
-        cur->next = n;
+// Insert many values at the end of the list in one go
+size_t list_insert_many(Node **head, const uint16_t *values, size_t count){
+    if (!values || count == 0)
+        return 0;
+
+    // Step 1: Build the whole chain locally before taking the list lock;
+    // the node pool refills itself in slabs, so this is batched allocation
+    Node *first = NULL;
+    Node *last  = NULL;
+    for (size_t i = 0; i < count; ++i) {
+        Node *n = new_node(values[i]);
+        if (!n) {
+            // All or nothing: recycle what was built and report failure
+            while (first) {
+                Node *next = first->next;
+                node_pool_put(first);
+                first = next;
+            }
+            fprintf(stderr, "list_insert_many: allocation failed\n");
+            return 0;
+        }
+        if (last)
+            last->next = n;
+        else
+            first = n;
+        last = n;
+    }
+
+    // Step 2: Splice the pre-built chain in with one pointer swap. A
+    // sorted list cannot take the chain wholesale; place node by node.
+    LOCK();
+    if (sorted_owner == head) {
+        while (first) {
+            Node *next = first->next;
+            sorted_insert(head, first);
+            first = next;
+        }
+        count_adjust(head, (long)count);
+        UNLOCK();
+        return count;
+    }
+    if (*head == NULL) {
+        NEXT_STORE(*head, first);
+    } else {
+        // Same guarded append as list_insert: couple past any nodes an
+        // insert_after added behind the cached tail
+        Node *tail = get_tail(head);
+        pthread_mutex_lock(&tail->lock);
+        while (tail->next) {
+            Node *nx = tail->next;
+            pthread_mutex_lock(&nx->lock);
+            pthread_mutex_unlock(&tail->lock);
+            tail = nx;
+        }
+        NEXT_STORE(tail->next, first);
+        pthread_mutex_unlock(&tail->lock);
     }
 
-    // Step 6: Unlock the list
+    // Step 3: The chain's last node is the new tail
+    tail_owner = head;
+    tail_node  = last;
+    count_adjust(head, (long)count);
     UNLOCK();
+    return count;
+}
+
+// Parallel construction: the input array is cut into one slice per
+// worker thread, each worker builds a private chain from its slice with
+// no shared state but the node pool, and the chains are spliced
+// together and onto the list with one pointer swap each. The workers
+// only meet at pthread_join, so chain building scales with cores; the
+// serial part is the splice, which is O(threads).
+#define BUILD_MAX_THREADS 32
+
+// One worker's slice of the input and the chain it builds from it
+typedef struct {
+    const uint16_t *values; // This worker's slice of the input
+    size_t count;           // How many values the slice holds
+    Node *first;            // Head of the chain built so far
+    Node *last;             // Tail of the chain built so far
+    int failed;             // Set when an allocation failed mid-slice
+} BuildShard;
+
+static void *build_worker(void *arg) {
+    BuildShard *s = arg;
+    for (size_t i = 0; i < s->count; ++i) {
+        Node *n = new_node(s->values[i]);
+        if (!n) {
+            s->failed = 1;
+            break;
+        }
+        if (s->last)
+            s->last->next = n;
+        else
+            s->first = n;
+        s->last = n;
+    }
+    return NULL;
+}
+
+// Build a list from an array using up to `threads` worker threads
+size_t list_build_parallel(Node **head, const uint16_t *values, size_t count, int threads){
+    if (!values || count == 0)
+        return 0;
+
+    // Step 1: Clamp the thread count; a shard per value is the most
+    // that makes sense, and the shard array lives on the stack
+    if (threads < 1)
+        threads = 1;
+    if (threads > BUILD_MAX_THREADS)
+        threads = BUILD_MAX_THREADS;
+    if ((size_t)threads > count)
+        threads = (int)count;
+
+    // Step 2: Cut the input into contiguous slices, one per worker, so
+    // the spliced result keeps the input order
+    pthread_t tid[BUILD_MAX_THREADS];
+    BuildShard shard[BUILD_MAX_THREADS];
+    size_t per = count / (size_t)threads;
+    size_t extra = count % (size_t)threads;
+    size_t at = 0;
+    for (int i = 0; i < threads; ++i) {
+        shard[i].values = values + at;
+        shard[i].count  = per + (i < (int)extra ? 1 : 0);
+        shard[i].first  = NULL;
+        shard[i].last   = NULL;
+        shard[i].failed = 0;
+        at += shard[i].count;
+        pthread_create(&tid[i], NULL, build_worker, &shard[i]);
+    }
+    for (int i = 0; i < threads; ++i)
+        pthread_join(tid[i], NULL);
+
+    // Step 3: All or nothing, like list_insert_many; on any failure the
+    // part-built chains go back to the node pool
+    int failed = 0;
+    for (int i = 0; i < threads; ++i)
+        failed |= shard[i].failed;
+    if (failed) {
+        for (int i = 0; i < threads; ++i) {
+            Node *n = shard[i].first;
+            while (n) {
+                Node *next = n->next;
+                node_pool_put(n);
+                n = next;
+            }
+        }
+        fprintf(stderr, "list_build_parallel: allocation failed\n");
+        return 0;
+    }
+
+    // Step 4: Splice the shard chains into one: a single pointer swap
+    // per worker (skipping shards that got an empty slice)
+    Node *first = NULL;
+    Node *last  = NULL;
+    for (int i = 0; i < threads; ++i) {
+        if (!shard[i].first)
+            continue;
+        if (last)
+            last->next = shard[i].first;
+        else
+            first = shard[i].first;
+        last = shard[i].last;
+    }
+
+    // Step 5: Hang the combined chain on the list, exactly like
+    // list_insert_many splices its pre-built chain
+    LOCK();
+    if (sorted_owner == head) {
+        // A sorted list cannot take the chain wholesale; place node by
+        // node (the parallel part was building the nodes)
+        while (first) {
+            Node *next = first->next;
+            sorted_insert(head, first);
+            first = next;
+        }
+        count_adjust(head, (long)count);
+        UNLOCK();
+        return count;
+    }
+    if (*head == NULL) {
+        NEXT_STORE(*head, first);
+    } else {
+        Node *tail = get_tail(head);
+        pthread_mutex_lock(&tail->lock);
+        while (tail->next) {
+            Node *nx = tail->next;
+            pthread_mutex_lock(&nx->lock);
+            pthread_mutex_unlock(&tail->lock);
+            tail = nx;
+        }
+        NEXT_STORE(tail->next, first);
+        pthread_mutex_unlock(&tail->lock);
+    }
+    tail_owner = head;
+    tail_node  = last;
+    count_adjust(head, (long)count);
+    UNLOCK();
+    return count;
 }
 
 // Insert a node after a "specific node"
@@ -72,21 +624,24 @@ void list_insert_after(Node *prev_node, uint16_t data){
         return;
     }
 
-    // Step 2: Lock the list
-    LOCK();
-
-    // Step 3: Allocate the new node
+    // Step 2: Allocate the new node before taking any lock
     Node *n = new_node(data);
     if (!n) {
         fprintf(stderr, "list_insert_after: allocation failed\n");
-        UNLOCK();
         return;
     }
 
-    // Step 4: Insert new node after "previous node" and unlock list
+    // Step 3: Only prev_node's own lock is needed for the splice, so
+    // inserts in different parts of the list run in parallel. The tail
+    // cache is not touched here; the append path revalidates it anyway.
+    pthread_mutex_lock(&prev_node->lock);
     n->next = prev_node->next;
-    prev_node->next = n;
-    UNLOCK();
+    NEXT_STORE(prev_node->next, n);
+    pthread_mutex_unlock(&prev_node->lock);
+
+    // Step 4: Only the node was given, not the list, so the cached count
+    // cannot be attributed; drop it and let the next count rescan
+    __atomic_store_n(&count_owner, NULL, __ATOMIC_RELEASE);
 }
 
 // Insert a node before a "specific node"
@@ -97,52 +652,68 @@ void list_insert_before(Node **head, Node *next_node, uint16_t data){
         return;
     }
 
-    // Step 2: Lock the list
+    // Step 2: Allocate the new node before taking any lock
+    Node *n = new_node(data);
+    if (!n) {
+        fprintf(stderr, "list_insert_before: allocation failed\n");
+        return;
+    }
+
+    // Step 3: Lock the list while we look at the head
     LOCK();
 
-    // Step 3: Special case; insert before head
+    // Step 4: Special case; insert before head
     if (*head == next_node) {
-        Node *n = new_node(data);
-        if (!n) {
-            fprintf(stderr, "list_insert_before: allocation failed\n");
-            UNLOCK();
-            return;
-        }
         n->next = *head;
-        *head = n;
+        NEXT_STORE(*head, n);
+        count_adjust(head, 1);
         UNLOCK();
         return;
     }
 
-    // Step 4: Walk through list to find node before "next_node"
-    Node *cur = *head;
-    while (cur && cur->next != next_node)
-        cur = cur->next;
-
-    // Step 5: If "next_node" not found, print error
-    if (!cur) {
-        fprintf(stderr, "list_insert_before: next_node not found\n");
+    // Step 5: Empty list means next_node cannot be found
+    if (!*head) {
         UNLOCK();
+        fprintf(stderr, "list_insert_before: next_node not found\n");
+        node_pool_put(n);
         return;
     }
 
-    // Step 6: Create and insert new node
-    Node *n = new_node(data);
-    if (!n) {
-        fprintf(stderr, "list_insert_before: allocation failed\n");
-        UNLOCK();
+    // Step 6: Lock the first node, drop the list lock, and walk
+    // hand-over-hand to the node just before "next_node". The cached
+    // count is bumped optimistically while the lock is still held; the
+    // rare not-found path below drops the cache instead of undoing.
+    Node *cur = *head;
+    pthread_mutex_lock(&cur->lock);
+    count_adjust(head, 1);
+    UNLOCK();
+    while (cur->next && cur->next != next_node) {
+        Node *nx = cur->next;
+        pthread_mutex_lock(&nx->lock);
+        pthread_mutex_unlock(&cur->lock);
+        cur = nx;
+    }
+
+    // Step 7: If "next_node" not found, print error and give the node back
+    if (!cur->next) {
+        pthread_mutex_unlock(&cur->lock);
+        fprintf(stderr, "list_insert_before: next_node not found\n");
+        node_pool_put(n);
+        __atomic_store_n(&count_owner, NULL, __ATOMIC_RELEASE); // Undo the bump
         return;
     }
-    n->next = cur->next;
-    cur->next = n;
 
-    // Step 7: Unlock the list
-    UNLOCK();
+    // Step 8: Splice in while holding only the predecessor's lock
+    n->next = cur->next;
+    NEXT_STORE(cur->next, n);
+    pthread_mutex_unlock(&cur->lock);
 }
 
 // Delete first node that matches the data
 void list_delete(Node **head, uint16_t data){
-    // Step 1: Lock the list
+    // Step 1: Lock the list. Delete keeps this lock for the whole walk
+    // (it may touch *head and the tail cache), but also couples the
+    // per-node locks so it never frees a node a concurrent reader holds.
     LOCK();
 
     // Step 2: Check if the list is empty
@@ -152,122 +723,339 @@ void list_delete(Node **head, uint16_t data){
         return;
     }
 
-    // Step 3: Walk through list to find the matching node
-    Node *cur = *head;
-    Node *prev = NULL;
-    while (cur && cur->data != data) {
-        prev = cur;
-        cur = cur->next;
+    // A lane sample may be about to point at a removed node; empty the
+    // lane and let the next search or insert rebuild it
+    if (sorted_owner == head) {
+        express_len   = 0;
+        express_stale = EXPRESS_STRIDE;
     }
 
-    // Step 4: If not found, print and exit
-    if (!cur) {
-        fprintf(stderr, "list_delete: value %u not found\n", data);
+    // Step 3: Special case; the head itself matches
+    Node *cur = *head;
+    pthread_mutex_lock(&cur->lock);
+    if (cur->data == data) {
+        NEXT_STORE(*head, cur->next);
+        if (tail_owner == head && tail_node == cur) {
+            tail_owner = NULL;
+            tail_node  = NULL;
+        }
+        pthread_mutex_unlock(&cur->lock);
+
+        // The unlinked node keeps pointing into the list; wait out any
+        // lock-free reader standing on it before recycling
+        wait_for_readers();
+        node_pool_put(cur);
+        count_adjust(head, -1);
         UNLOCK();
         return;
     }
 
-    // Step 5: Remove node from list
-    if (!prev) // deleting the head
-        *head = cur->next;
-    else
-        prev->next = cur->next;
+    // Step 4: Walk hand-over-hand to find the matching node
+    Node *prev = cur;
+    while (prev->next) {
+        cur = prev->next;
+        pthread_mutex_lock(&cur->lock);
+        if (cur->data == data) {
+            // Step 5: Unlink while holding both neighbor locks
+            NEXT_STORE(prev->next, cur->next);
+
+            // Step 6: Keep the cached tail coherent if we just removed it
+            if (tail_owner == head && tail_node == cur)
+                tail_node = prev;
+
+            // Step 7: Wait out lock-free readers that may still be
+            // standing on the unlinked node, then recycle and unlock
+            pthread_mutex_unlock(&cur->lock);
+            pthread_mutex_unlock(&prev->lock);
+            wait_for_readers();
+            node_pool_put(cur);
+            count_adjust(head, -1);
+            UNLOCK();
+            return;
+        }
+        pthread_mutex_unlock(&prev->lock);
+        prev = cur;
+    }
 
-    // Step 6: Clean up node and unlock the list
-    pthread_mutex_destroy(&cur->lock);
-    mem_free(cur);
+    // Step 8: If not found, print and exit
+    pthread_mutex_unlock(&prev->lock);
+    fprintf(stderr, "list_delete: value %u not found\n", data);
     UNLOCK();
 }
 
 // Search for node by value
 Node *list_search(Node **head, uint16_t data){
-    // Step 1: Lock the list
-    LOCK();
+    // Step 1: In sorted mode, consult the express lane under the lock to
+    // find a starting point near the key. Entering the epoch while
+    // still holding the lock keeps the start node pinned: a deleter owns
+    // the write side for its whole grace period, so it cannot recycle
+    // the node between our lookup and our walk.
+    Node *cur;
+    unsigned e;
+    if (sorted_owner == head) {
+        // The read side is enough for the lane lookup, so concurrent
+        // sorted searches no longer serialize on the lock. Only when
+        // the lane needs a rebuild (which writes it) is the read side
+        // traded for the write side.
+        RDLOCK();
+        if (express_is_stale()) {
+            UNLOCK();
+            LOCK();
+            express_freshen(head);
+        }
+        e = read_enter();
+        cur = express_seek(data);
+        if (!cur)
+            cur = NEXT_LOAD(*head);
+        UNLOCK();
 
-    // Step 2: Walk through the list looking for the value
-    Node *cur = *head;
-    while (cur) {
+        // Step 2: Scan at most a stride's worth of nodes; the list is
+        // ordered, so passing the key means it is not there
+        Node *found = NULL;
+        for (; cur && cur->data <= data; cur = NEXT_LOAD(cur->next)) {
+            if (cur->data == data) {
+                found = cur;
+                break;
+            }
+        }
+        read_exit(e);
+        return found;
+    }
+
+    // Step 3: Unsorted list: announce ourselves as a reader; no lock of
+    // any kind is taken, so searches never contend with anyone
+    e = read_enter();
+
+    // Step 4: Walk via acquire loads. Deleted nodes keep their next
+    // pointer aimed into the list until the epoch drains, so the walk
+    // stays on track even if a node is unlinked under our feet.
+    Node *found = NULL;
+    for (cur = NEXT_LOAD(*head); cur; cur = NEXT_LOAD(cur->next)) {
+        __builtin_prefetch(cur->next); // Hide the miss on the next node
         if (cur->data == data) {
-            UNLOCK();
-            return cur;
+            found = cur;
+            break;
         }
-        cur = cur->next;
     }
 
-    // Step 3: Not found, unlock and return NULL
-    UNLOCK();
-    return NULL;
+    // Step 5: Leave the read side and hand back the result
+    read_exit(e);
+    return found;
+}
+
+// Search for many values in one traversal. K separate list_search
+// calls visit K*N nodes; this walks the list once and tests every
+// visited node against the whole key set, so the cost is N visits plus
+// a key-set scan per node — and that scan compares eight keys per SSE2
+// instruction where the compiler offers it. Like the unsorted search,
+// the walk is a lock-free epoch-protected read.
+size_t list_search_many(Node **head, const uint16_t *keys, size_t nkeys, Node **results){
+    // Step 1: Validate input and start with every slot empty
+    if (!keys || !results || nkeys == 0)
+        return 0;
+    for (size_t i = 0; i < nkeys; ++i)
+        results[i] = NULL;
+
+    // Step 2: In sorted mode the walk can stop at the largest key
+    uint16_t max_key = 0;
+    int sorted = (sorted_owner == head);
+    if (sorted) {
+        for (size_t i = 0; i < nkeys; ++i) {
+            if (keys[i] > max_key)
+                max_key = keys[i];
+        }
+    }
+
+    // Step 3: One pass over the list; each node's value is matched
+    // against the key set, filling the first empty slot per key
+    size_t found = 0;
+    unsigned e = read_enter();
+    for (Node *cur = NEXT_LOAD(*head); cur && found < nkeys; cur = NEXT_LOAD(cur->next)) {
+        __builtin_prefetch(cur->next); // Hide the miss on the next node
+        uint16_t d = cur->data;
+        if (sorted && d > max_key)
+            break;
+        size_t i = 0;
+#ifdef __SSE2__
+        // Broadcast the node's value and compare eight keys per step;
+        // the movemask carries two bits per 16-bit lane
+        __m128i needle = _mm_set1_epi16((short)d);
+        for (; i + 8 <= nkeys; i += 8) {
+            __m128i batch = _mm_loadu_si128((const __m128i *)(keys + i));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(batch, needle));
+            while (mask) {
+                int bit = __builtin_ctz(mask);
+                size_t idx = i + (size_t)(bit >> 1);
+                mask &= ~(3 << (bit & ~1)); // Clear the lane's bit pair
+                if (!results[idx]) {
+                    results[idx] = cur;
+                    ++found;
+                }
+            }
+        }
+#endif
+        // Scalar tail (and the whole set without SSE2)
+        for (; i < nkeys; ++i) {
+            if (keys[i] == d && !results[i]) {
+                results[i] = cur;
+                ++found;
+            }
+        }
+    }
+    read_exit(e);
+    return found;
 }
 
-// Helper to print a list range (from start to end)
-static void print_range(Node **head, Node *start, Node *end){
-    // Step 1: Print opening bracket for the list output
-    putchar('[');
+// Output buffer for display formatting. Display used to printf each
+// element while holding list_mutex, which froze every other thread for
+// the whole dump; now the list is formatted into a buffer during a
+// lock-free read-side walk and flushed to stdout with one stdio call.
+// A fixed buffer (list_serialize) keeps counting past its capacity so
+// the caller can learn the full length; a growable one doubles as
+// needed.
+typedef struct
+{
+    char  *buf;   // The bytes, or NULL after an allocation failure
+    size_t len;   // Full formatted length, even past cap when fixed
+    size_t cap;   // Bytes buf can hold
+    int    fixed; // Caller-owned buffer: truncate instead of growing
+} OutBuf;
 
-    // Step 2: If "start" is provided begin from it, otherwise start from the head of the list
-    Node *cur = start ? start : *head;
-    int first = 1; // Used to decide whether to print a comma before the number
+// Append n bytes, growing the buffer or truncating as configured
+static void out_append(OutBuf *o, const char *s, size_t n) {
+    if (o->buf && !o->fixed && o->len + n > o->cap) {
+        size_t cap = o->cap ? o->cap : 256;
+        while (o->len + n > cap)
+            cap *= 2;
+        char *grown = realloc(o->buf, cap);
+        if (grown) {
+            o->buf = grown;
+            o->cap = cap;
+        } else {
+            free(o->buf);
+            o->buf = NULL; // Out of memory; keep counting, emit nothing
+        }
+    }
+    if (o->buf) {
+        size_t room = o->cap > o->len ? o->cap - o->len : 0;
+        memcpy(o->buf + o->len, s, n < room ? n : room);
+    }
+    o->len += n;
+}
 
-    // Step 3: Walk through the list
+// Fast unsigned-to-decimal conversion; returns the digit count
+static size_t u16_str(uint16_t v, char *dst) {
+    char tmp[5];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = tmp[n - 1 - i];
+    return n;
+}
+
+// Format a list range as "[a, b, c]" into the buffer. Runs on the read
+// side: the caller has entered an epoch and we follow acquire loads.
+static void fmt_range(OutBuf *o, Node *cur, Node *end) {
+    // Step 1: Opening bracket for the list output
+    out_append(o, "[", 1);
+
+    // Step 2: Walk the range, separating the numbers with ", "
+    int first = 1; // Whether a comma is due before the number
     while (cur) {
         if (!first)
-            printf(", ");
+            out_append(o, ", ", 2);
 
-        printf("%u", cur->data);
+        char num[5];
+        out_append(o, num, u16_str(cur->data, num));
         if (cur == end)
             break;
 
-        cur = cur->next; // Move to the next node
+        cur = NEXT_LOAD(cur->next); // Move to the next node
         first = 0;
     }
-    // Step 4: Print closing bracket for the list output
-    putchar(']');
+
+    // Step 3: Closing bracket for the list output
+    out_append(o, "]", 1);
 }
 
-// Print all elements in the list
-void list_display(Node **head) {
-    // Step 1: Lock the list
-    LOCK();
+// Format a range into a fresh buffer and flush it with one stdio call
+static void display_range(Node **head, Node *start, Node *end) {
+    // Step 1: Format during a lock-free read-side walk; nobody waits on
+    // us while stdio or formatting does its work
+    unsigned e = read_enter();
+    OutBuf o = { malloc(256), 0, 256, 0 };
+    fmt_range(&o, start ? start : NEXT_LOAD(*head), end);
+    read_exit(e);
 
-    // Step 2: Print the whole list (start and end are NULL)
-    print_range(head, NULL, NULL);
+    // Step 2: One write outside any lock, then release the buffer
+    if (o.buf) {
+        fwrite(o.buf, 1, o.len, stdout);
+        free(o.buf);
+    }
+}
 
-    // Step 3: Unlock the list
-    UNLOCK();
+// Print all elements in the list
+void list_display(Node **head) {
+    display_range(head, NULL, NULL);
 }
 
 // Print elements between two given nodes
 void list_display_range(Node **head, Node *start_node, Node *end_node) {
-    // Step 1: Lock the list
-    LOCK();
-
-    // Step 2: If the list is empty, just print "[]" and return
-    if (!*head) {
-        printf("[]");
-        UNLOCK();
-        return;
-    }
+    display_range(head, start_node, end_node);
+}
 
-    // Step 3: Call the helper to print from "start_node" to "end_node"
-    print_range(head, start_node, end_node);
+// Serialize the list as "[a, b, c]" into a caller-supplied buffer
+size_t list_serialize(Node **head, char *buf, size_t cap) {
+    // Step 1: Format straight into the caller's buffer, truncating if
+    // it runs out of room but still counting the full length
+    unsigned e = read_enter();
+    OutBuf o = { buf, 0, cap ? cap - 1 : 0, 1 };
+    fmt_range(&o, NEXT_LOAD(*head), NULL);
+    read_exit(e);
 
-    // Step 4: Unlock the list
-    UNLOCK();
+    // Step 2: Terminate and report how long the full output is
+    if (buf && cap)
+        buf[o.len < cap - 1 ? o.len : cap - 1] = '\0';
+    return o.len;
 }
 
 // Count the total number of nodes in the list
 int list_count_nodes(Node **head) {
-    // Step 1: Lock the list
-    LOCK();
+    // Step 1: The common case is an O(1) read of the cached count; no
+    // walk, no lock. Concurrent writers may leave the value a step
+    // behind for a moment, which is fine for monitoring.
+    if (__atomic_load_n(&count_owner, __ATOMIC_ACQUIRE) == head)
+        return (int)__atomic_load_n(&count_value, __ATOMIC_RELAXED);
+
+    // Step 2: The cache tracks another list (or was dropped by an
+    // insert_after); rescan once under the lock and adopt it
+    return list_count_nodes_exact(head);
+}
+
+// Count by walking the whole list; resynchronizes the cached count
+int list_count_nodes_exact(Node **head) {
+    // Step 1: The read side is enough: it keeps writers out so the walk
+    // sees a settled length, while concurrent exact counts (which would
+    // all store the same answer) may share the lock
+    RDLOCK();
 
     // Step 2: Walk through the list and count each node
-    int count = 0;
-    for (Node *cur = *head; cur; cur = cur->next)
+    long count = 0;
+    for (Node *cur = *head; cur; cur = cur->next) {
+        __builtin_prefetch(cur->next); // Hide the miss on the next node
         ++count;
+    }
+
+    // Step 3: The scan is authoritative; let the cache track this list
+    __atomic_store_n(&count_value, count, __ATOMIC_RELAXED);
+    __atomic_store_n(&count_owner, head, __ATOMIC_RELEASE);
 
-    // Step 3: Unlock and return the count
+    // Step 4: Unlock and return the count
     UNLOCK();
-    return count;
+    return (int)count;
 }
 
 // Free all nodes and clean up memory
@@ -275,19 +1063,48 @@ void list_cleanup(Node **head) {
     // Step 1: Lock the list
     LOCK();
 
-    // Step 2: Walk through the list and free each node one by one
+    // Step 2: Detach the whole list, then wait out lock-free readers
+    // before any node is destroyed; readers that started earlier finish
+    // their walk over the now-detached chain during the grace period
     Node *cur = *head;
+    NEXT_STORE(*head, NULL);
+    wait_for_readers();
+
+    // Step 3: Free each node one by one, taking each node's lock first
+    // so a straggling writer (insert_after) is waited out
+    if (cur)
+        pthread_mutex_lock(&cur->lock);
     while (cur) {
         Node *next = cur->next; // Store pointer to next node before freeing current
+        if (next)
+            pthread_mutex_lock(&next->lock);
+        pthread_mutex_unlock(&cur->lock);
         pthread_mutex_destroy(&cur->lock); // Destroy the mutex
-        mem_free(cur); // Free the memory used by the node
+        mem_free_from(list_pool, cur); // Free the memory used by the node
         cur = next; // Move to the next node
     }
 
-    // Step 3: Reset the head to NULL since the list is now empty
-    *head = NULL;
+    // Step 4: Forget the cached tail and the express lane; the list and
+    // the pool backing the lane are both going away
+    if (tail_owner == head) {
+        tail_owner = NULL;
+        tail_node  = NULL;
+    }
+    express_drop();
+    sorted_owner = NULL;
+    if (__atomic_load_n(&count_owner, __ATOMIC_ACQUIRE) == head) {
+        __atomic_store_n(&count_value, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&count_owner, NULL, __ATOMIC_RELEASE);
+    }
 
-    // Step 4: Deinitialize the memory pool and unlock the list
-    mem_deinit();
+    // Step 5: Drop the node pool and the backing memory pool: a bound
+    // pool is destroyed wholesale, the global pool is deinitialized
+    node_pool_drain();
+    if (list_pool) {
+        mem_pool_destroy(list_pool);
+        list_pool = NULL;
+    } else {
+        mem_deinit();
+    }
     UNLOCK();
 }
\ No newline at end of file
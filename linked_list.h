@@ -15,16 +15,50 @@ typedef struct Node
 
 // Function declarations
 void list_init(Node **head, size_t size);
+// Like list_init, but the list keeps ascending data order: list_insert
+// places by value and list_search skips ahead via an express-lane index
+// instead of scanning from the head.
+void list_init_sorted(Node **head, size_t size);
+// Like list_init, but binds the list to a caller-created pool (see
+// mem_pool_create) instead of reinitializing the global one; cleanup
+// then destroys that pool wholesale and leaves the global pool alone.
+void list_init_from(Node **head, mem_pool_t *pool);
+// Rebinds head to a node chain already in the pool, by the head node's
+// pool offset (from mem_offset_of, saved before mem_snapshot). Call
+// after mem_restore for a warm restart; pass (size_t)-1 for an empty
+// list. Only valid when the restore kept the pool's original address.
+void list_attach(Node **head, size_t offset);
 void list_insert(Node **head, uint16_t data);
+// Appends count values in one go: nodes are built off-lock and spliced in
+// with a single pointer swap. All or nothing; returns count or 0.
+size_t list_insert_many(Node **head, const uint16_t *values, size_t count);
+// Builds the list from an array with up to `threads` worker threads:
+// each builds a private chain from its slice of the input, then the
+// chains are spliced in order with one pointer swap apiece. All or
+// nothing; returns count or 0.
+size_t list_build_parallel(Node **head, const uint16_t *values, size_t count, int threads);
 void list_insert_after(Node *prev_node, uint16_t data);
 void list_insert_before(Node **head, Node *next_node, uint16_t data);
 void list_delete(Node **head, uint16_t data);
 Node *list_search(Node **head, uint16_t data);
+// Locates many values in a single traversal instead of one walk per
+// key, comparing the key set with SSE2 where available. results[i]
+// gets the first node holding keys[i], or NULL if the value is absent.
+// Returns how many keys were found.
+size_t list_search_many(Node **head, const uint16_t *keys, size_t nkeys, Node **results);
 
 void list_display(Node **head);
 void list_display_range(Node **head, Node *start_node, Node *end_node);
+// Writes the list as "[a, b, c]" into buf (always NUL-terminated when
+// cap > 0) without touching stdout. Returns the full formatted length
+// excluding the terminator; if it is cap or more, the output was
+// truncated and a larger buffer is needed.
+size_t list_serialize(Node **head, char *buf, size_t cap);
 
 int list_count_nodes(Node **head);
+// Counts by walking the whole list instead of reading the cached count;
+// kept for debugging and for verifying the incremental counter.
+int list_count_nodes_exact(Node **head);
 void list_cleanup(Node **head);
 
 #endif // LINKED_LIST_H
@@ -3,160 +3,1250 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include <errno.h>
- 
+#include <unistd.h>
+#include <sys/mman.h>
+
+typedef struct PoolSegment PoolSegment;
+
 typedef struct MemBlock {
-     size_t offset;          // Where this block starts in the memory pool
+     size_t offset;          // Where this block starts in the pool's offset space
      size_t size;            // How big this block is
      int    is_free;         // 1 = block is free, 0 = it's in use
+     PoolSegment *seg;       // The segment whose memory backs this block
      struct MemBlock *next;  // Points to the next block in the list
+     struct MemBlock *prev;  // Points to the previous block, for O(1) coalescing
+     struct MemBlock *next_free; // Next block in the same free-list size class
+     struct MemBlock *prev_free; // Previous block in the same free-list size class
+     struct MemBlock *hash_next; // Next block in the same offset-hash bucket
 } MemBlock;
 
-//Global variables
-static char      *memory_pool  = NULL;   // The entire memory pool
-static size_t     pool_size    = 0;      // How big the memory pool is
-static MemBlock  *block_list   = NULL;   // The list of memory blocks (free/used)
- 
-static pthread_mutex_t mem_mutex = PTHREAD_MUTEX_INITIALIZER; // The global lock
- 
- // Shortcuts for locking/unlocking the mutex
-#define LOCK()   pthread_mutex_lock(&mem_mutex)
-#define UNLOCK() pthread_mutex_unlock(&mem_mutex)
- 
-// Helper function to create the first block
-static void create_initial_block(size_t size) {
-     // Step 1: Allocate memory for a new block
-     block_list = malloc(sizeof(MemBlock));
- 
-     // Step 2: If something went wrong, clean up and exit
-     if (!block_list) {
-         fprintf(stderr, "Error: Could not allocate block list (%s)\n", strerror(errno));
-         free(memory_pool);
-         exit(EXIT_FAILURE);
+// The pool is a chain of segments. mem_init creates the first one; with
+// auto-grow enabled, more are added when the pool runs out and released
+// again once they are entirely free. Block offsets live in a single
+// virtual offset space with a gap between segments, so offsets stay
+// unique and blocks from different segments never look adjacent.
+struct PoolSegment {
+     struct PoolSegment *next;  // Next segment in the chain
+     char  *base;               // Where this segment's memory starts
+     size_t virt_start;         // Segment's start in the virtual offset space
+     size_t size;               // How many bytes the segment holds
+     size_t dirty_end;          // Bytes below this segment offset may hold old
+                                // data; everything at or above it has never been
+                                // written and is still zero (mmap segments only)
+     int    is_mmap;            // 1 = mmap backing, 0 = malloc backing
+};
+
+#define SEGMENT_GAP 64  // Virtual-offset gap kept between segments
+
+// Freed ranges at least this big in an mmap-backed segment are handed
+// back to the OS with madvise(MADV_DONTNEED)
+#define MADVISE_THRESHOLD (64 * 1024)
+
+// In lazy-coalescing mode, a compact sweep runs by itself once this
+// many frees have been deferred without any merging
+#define MEM_COMPACT_WATERMARK 1024
+
+// How many size classes the free-list index uses. Classes 0-15 cover
+// 16-byte steps up to 256 bytes (our common allocation sizes), classes
+// 16 and up each cover one power of two above that.
+#define NUM_SIZE_CLASSES 32
+
+// Metadata arena: MemBlock nodes are carved out of slabs and recycled
+// through a freelist, so alloc/free never call the system allocator on
+// the hot path (one slab is grabbed up front in mem_init, more only if
+// the pool fragments into more blocks than a slab holds).
+#define ARENA_SLAB_NODES 256
+
+typedef struct ArenaSlab {
+     struct ArenaSlab *next;               // Next slab, so teardown can free them all
+     MemBlock nodes[ARENA_SLAB_NODES];     // The MemBlock nodes this slab provides
+} ArenaSlab;
+
+// One independent memory pool: its segments, block bookkeeping, lock
+// and counters all live here, so separate pools are separate contention
+// domains and one pool's teardown cannot touch another's memory. The
+// classic global API operates on a built-in default pool; handles from
+// mem_pool_create get the same machinery with their own state.
+struct mem_pool {
+     PoolSegment *segments;     // All pool segments, primary first
+     size_t     next_virt;      // Next unused virtual offset
+     size_t     pool_size;      // Total bytes across all segments
+     size_t     grow_quantum;   // Smallest size a grown segment gets
+     int        auto_grow;      // Whether the pool may grow on demand
+     int        use_mmap;       // Whether segments are mmap-backed
+     MemBlock  *block_list;     // The list of memory blocks (free/used)
+     MemBlock  *free_lists[NUM_SIZE_CLASSES]; // Free blocks indexed by size class
+
+     // Offset hash table: maps a block's pool offset to its MemBlock so
+     // mem_free and mem_resize resolve a user pointer in O(1) instead of
+     // scanning the whole chain. Every block (free or used) is in here.
+     MemBlock **offset_table;   // The hash buckets
+     size_t     offset_buckets; // Bucket count, always a power of two
+
+     ArenaSlab *arena_slabs;    // Every metadata slab this pool allocated
+     MemBlock  *node_freelist;  // Unused MemBlock nodes, linked by next
+
+     // Lazy coalescing (opt-in): frees skip the neighbor merging and a
+     // compact sweep merges whole free runs in one pass instead —
+     // automatically after MEM_COMPACT_WATERMARK deferred frees, when an
+     // allocation would otherwise fail, or via mem_compact.
+     int           lazy_coalesce; // Whether frees defer their merging
+     unsigned long lazy_frees;    // Frees deferred since the last sweep
+
+     // Scratch flag set by pool_alloc_aligned on every successful carve:
+     // whether the block it just handed out lies entirely in pages the
+     // segment has never written, i.e. is known to be zero already.
+     // mem_calloc reads it inside the same lock hold to skip its memset.
+     int        last_alloc_zero;
+
+     pthread_mutex_t mutex;     // The pool's lock
+
+     // Operation counters for mem_stats. The op counters are only touched
+     // while the pool's mutex is held; the contention counter is atomic
+     // because it is bumped before the lock is taken.
+     unsigned long stat_alloc_count;     // Successful pool allocations
+     unsigned long stat_free_count;      // Frees that reached the pool
+     unsigned long stat_resize_count;    // mem_resize calls
+     unsigned long stat_failed_allocs;   // Allocations that returned NULL
+     unsigned long stat_lock_contention; // Times LOCK() had to wait
+
+     // Power-of-two histogram of requested allocation sizes: bucket i
+     // counts requests with 2^(i-1) < size <= 2^i (bucket 0 is size <= 1).
+     // Bumped atomically so the thread-cache fast path can record too.
+     unsigned long size_hist[MEM_SIZE_HIST_BUCKETS];
+};
+
+// The pool behind the classic global mem_* functions
+static mem_pool_t default_pool = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+ // Shortcuts for locking/unlocking a pool's mutex; LOCK() counts the
+ // times it could not take the mutex right away
+#define LOCK(p)                                                    \
+    do {                                                           \
+        if (pthread_mutex_trylock(&(p)->mutex) != 0) {             \
+            __sync_fetch_and_add(&(p)->stat_lock_contention, 1);   \
+            pthread_mutex_lock(&(p)->mutex);                       \
+        }                                                          \
+    } while (0)
+#define UNLOCK(p) pthread_mutex_unlock(&(p)->mutex)
+
+// Count n requests of the given size in the pool's histogram
+static void hist_record(mem_pool_t *p, size_t size, unsigned long n) {
+     int bucket = 0;
+     while (bucket < MEM_SIZE_HIST_BUCKETS - 1 && ((size_t)1 << bucket) < size)
+         ++bucket;
+     __atomic_fetch_add(&p->size_hist[bucket], n, __ATOMIC_RELAXED);
+}
+
+// Print the nonzero histogram buckets, for the MEM_HIST_DUMP dump
+static void hist_dump(mem_pool_t *p) {
+     fprintf(stderr, "mem_deinit: allocation size histogram\n");
+     for (int i = 0; i < MEM_SIZE_HIST_BUCKETS; ++i) {
+         if (!p->size_hist[i])
+             continue;
+         fprintf(stderr, "  <= %10lu bytes: %lu\n",
+                 (unsigned long)1 << i, p->size_hist[i]);
+     }
+}
+
+// Get a MemBlock node from the pool's arena, growing it by one slab if empty
+static MemBlock *block_new(mem_pool_t *p) {
+     // Step 1: Refill the freelist from a fresh slab if it ran dry
+     if (!p->node_freelist) {
+         ArenaSlab *slab = malloc(sizeof(ArenaSlab));
+         if (!slab)
+             return NULL;
+         slab->next     = p->arena_slabs;
+         p->arena_slabs = slab;
+         for (int i = 0; i < ARENA_SLAB_NODES; ++i) {
+             slab->nodes[i].next = p->node_freelist;
+             p->node_freelist = &slab->nodes[i];
+         }
+     }
+
+     // Step 2: Pop a node off the freelist
+     MemBlock *b = p->node_freelist;
+     p->node_freelist = b->next;
+     return b;
+}
+
+// Return a MemBlock node to the pool's arena freelist
+static void block_release(mem_pool_t *p, MemBlock *b) {
+     b->next = p->node_freelist;
+     p->node_freelist = b;
+}
+
+// Pick the hash bucket for a pool offset
+static size_t hash_bucket(mem_pool_t *p, size_t offset) {
+     // Fibonacci hashing spreads the mostly-sequential offsets around
+     return (offset * (size_t)0x9E3779B97F4A7C15ULL) & (p->offset_buckets - 1);
+}
+
+// Add a block to the offset hash (call whenever a block gets its offset)
+static void hash_insert(mem_pool_t *p, MemBlock *block) {
+     size_t b = hash_bucket(p, block->offset);
+     block->hash_next = p->offset_table[b];
+     p->offset_table[b] = block;
+}
+
+// Remove a block from the offset hash (call before releasing its node)
+static void hash_remove(mem_pool_t *p, MemBlock *block) {
+     MemBlock **pp = &p->offset_table[hash_bucket(p, block->offset)];
+     while (*pp && *pp != block)
+         pp = &(*pp)->hash_next;
+     if (*pp)
+         *pp = block->hash_next;
+     block->hash_next = NULL;
+}
+
+// Find the block starting at the given pool offset, if any
+static MemBlock *hash_lookup(mem_pool_t *p, size_t offset) {
+     for (MemBlock *b = p->offset_table[hash_bucket(p, offset)]; b; b = b->hash_next) {
+         if (b->offset == offset)
+             return b;
+     }
+     return NULL;
+}
+
+// The primary segment is the one mem_init made; it is never released.
+// Segments are pushed on the front of the chain, so it sits at the end.
+static PoolSegment *segments_primary(mem_pool_t *p) {
+     PoolSegment *seg = p->segments;
+     while (seg && seg->next)
+         seg = seg->next;
+     return seg;
+}
+
+// Turn a block's virtual offset into the real address of its memory
+static char *block_ptr(MemBlock *block) {
+     return block->seg->base + (block->offset - block->seg->virt_start);
+}
+
+// Find the segment whose memory contains ptr, if any
+static PoolSegment *segment_of(mem_pool_t *p, void *ptr) {
+     for (PoolSegment *seg = p->segments; seg; seg = seg->next) {
+         if ((char *)ptr >= seg->base && (char *)ptr < seg->base + seg->size)
+             return seg;
+     }
+     return NULL;
+}
+
+// Map a block size to the index of its free-list size class
+static int size_class(size_t size) {
+     // Step 1: Small sizes get one class per 16 bytes
+     if (size <= 256)
+         return size ? (int)((size - 1) / 16) : 0;
+
+     // Step 2: Larger sizes get one class per power of two
+     int cls = 16;
+     size_t limit = 512;
+     while (cls < NUM_SIZE_CLASSES - 1 && size > limit) {
+         limit <<= 1;
+         ++cls;
+     }
+     return cls;
+}
+
+// Put a free block at the front of its size class list
+static void free_insert(mem_pool_t *p, MemBlock *block) {
+     int cls = size_class(block->size);
+     block->prev_free = NULL;
+     block->next_free = p->free_lists[cls];
+     if (p->free_lists[cls])
+         p->free_lists[cls]->prev_free = block;
+     p->free_lists[cls] = block;
+}
+
+// Take a block out of its size class list
+static void free_remove(mem_pool_t *p, MemBlock *block) {
+     if (block->prev_free)
+         block->prev_free->next_free = block->next_free;
+     else
+         p->free_lists[size_class(block->size)] = block->next_free;
+     if (block->next_free)
+         block->next_free->prev_free = block->prev_free;
+     block->next_free = NULL;
+     block->prev_free = NULL;
+}
+
+// Add a segment of the given size to the pool, with one free block
+// covering all of it (pool mutex must be held, except during setup)
+static PoolSegment *segment_add(mem_pool_t *p, size_t size) {
+     // Step 1: Allocate the segment descriptor and its memory
+     PoolSegment *seg = malloc(sizeof(PoolSegment));
+     if (!seg)
+         return NULL;
+     if (p->use_mmap) {
+         // Pages fault in lazily, so a huge pool starts out costing
+         // almost no resident memory
+         seg->base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         if (seg->base == MAP_FAILED)
+             seg->base = NULL;
+     } else {
+         seg->base = malloc(size);
+     }
+     if (!seg->base) {
+         free(seg);
+         return NULL;
+     }
+     seg->is_mmap = p->use_mmap;
+
+     // A fresh anonymous mapping is all zero; malloc backing never is
+     seg->dirty_end = p->use_mmap ? 0 : size;
+
+     // Step 2: Grab a node for the segment's one big free block
+     MemBlock *block = block_new(p);
+     if (!block) {
+         free(seg->base);
+         free(seg);
+         return NULL;
      }
- 
-     // Step 3: Fill in the details for the very first block
-     block_list->offset  = 0;
-     block_list->size    = size;
-     block_list->is_free = 1;       // 1 = free
-     block_list->next    = NULL;    // No blocks after
+
+     // Step 3: Give the segment its own slice of the virtual offset space
+     seg->virt_start = p->next_virt;
+     seg->size       = size;
+     p->next_virt   += size + SEGMENT_GAP;
+     seg->next       = p->segments;
+     p->segments     = seg;
+     p->pool_size   += size;
+
+     // Step 4: Describe the whole segment as one free block
+     block->offset  = seg->virt_start;
+     block->size    = size;
+     block->is_free = 1;       // 1 = free
+     block->seg     = seg;
+     block->next    = p->block_list;
+     block->prev    = NULL;
+     if (p->block_list)
+         p->block_list->prev = block;
+     p->block_list = block;
+
+     // Step 5: Index it so mem_alloc and mem_free can find it without scanning
+     free_insert(p, block);
+     hash_insert(p, block);
+     return seg;
+}
+
+// Release a grown segment whose memory is entirely free again
+// (pool mutex must be held; block is the segment's single block, already
+// off the free lists)
+static void segment_release(mem_pool_t *p, PoolSegment *seg, MemBlock *block) {
+     // Step 1: Drop the block from the offset hash and the chain
+     hash_remove(p, block);
+     if (block->prev)
+         block->prev->next = block->next;
+     else
+         p->block_list = block->next;
+     if (block->next)
+         block->next->prev = block->prev;
+     block_release(p, block);
+
+     // Step 2: Unlink the segment and give its memory back
+     for (PoolSegment **pp = &p->segments; *pp; pp = &(*pp)->next) {
+         if (*pp == seg) {
+             *pp = seg->next;
+             break;
+         }
+     }
+     p->pool_size -= seg->size;
+     if (seg->is_mmap)
+         munmap(seg->base, seg->size);
+     else
+         free(seg->base);
+     free(seg);
+}
+
+// Set up a pool's hash table and primary segment; returns 0 on failure
+static int pool_setup(mem_pool_t *p, size_t size, int mmap_backed) {
+     p->use_mmap = mmap_backed;
+
+     // Step 1: Size the offset hash for the pool; one bucket per 32 bytes
+     // keeps the chains short without costing much memory
+     size_t buckets = 64;
+     while (buckets < size / 32)
+         buckets <<= 1;
+     p->offset_table = calloc(buckets, sizeof(MemBlock *));
+     if (!p->offset_table)
+         return 0;
+
+     // Step 2: Lock, create the primary segment, then unlock
+     LOCK(p);
+     p->next_virt      = 0;
+     p->offset_buckets = buckets;
+     p->grow_quantum   = size;
+     if (!segment_add(p, size)) {
+         UNLOCK(p);
+         free(p->offset_table);
+         p->offset_table = NULL;
+         return 0;
+     }
+     UNLOCK(p);
+     return 1;
+}
+
+// Free a pool's segments, metadata and hash, leaving it ready for a new
+// pool_setup (pool mutex must be held)
+static void pool_teardown(mem_pool_t *p) {
+     // Step 1: Free every pool segment
+     PoolSegment *seg = p->segments;
+     while (seg) {
+         PoolSegment *next = seg->next;
+         if (seg->is_mmap)
+             munmap(seg->base, seg->size);
+         else
+             free(seg->base);
+         free(seg);
+         seg = next;
+     }
+     p->segments  = NULL;
+     p->next_virt = 0;
+     p->pool_size = 0;
+
+     // Step 2: Free the metadata arena slabs (all MemBlock nodes live there)
+     ArenaSlab *slab = p->arena_slabs;
+     while (slab) {
+         ArenaSlab *next = slab->next;
+         free(slab);
+         slab = next;
+     }
+     p->arena_slabs   = NULL;
+     p->node_freelist = NULL;
+     p->block_list    = NULL;
+
+     // Step 3: Reset the free-list index and the offset hash
+     memset(p->free_lists, 0, sizeof(p->free_lists));
+     free(p->offset_table);
+     p->offset_table   = NULL;
+     p->offset_buckets = 0;
 }
- 
 
 // Set up the memory pool and first block
 void mem_init(size_t size) {
-     // Step 1: Allocate the full memory pool
-     memory_pool = malloc(size);
-     if (!memory_pool) {
+     if (!pool_setup(&default_pool, size, 0)) {
          fprintf(stderr, "Error: Could not allocate memory pool (%s)\n", strerror(errno));
          exit(EXIT_FAILURE);
      }
- 
-     // Step 2: Lock, initialize metadata, then unlock
-     LOCK();
-     pool_size = size;
-     create_initial_block(size);
-     UNLOCK();
 }
- 
-// Try to find space and give the user a pointer to it
-void *mem_alloc(size_t size) {
-     LOCK();
-     // Step 1: Special case; if size is 0, return first free block if any
-     if (size == 0) {
-         for (MemBlock *curr = block_list; curr; curr = curr->next) {
-             if (curr->is_free) {
-                 void *ptr = memory_pool + curr->offset;
-                 UNLOCK();
-                 return ptr;
+
+// Like mem_init, but the pool is reserved with mmap: pages commit
+// lazily on first touch, and big freed ranges go back to the OS
+void mem_init_mmap(size_t size) {
+     if (!pool_setup(&default_pool, size, 1)) {
+         fprintf(stderr, "Error: Could not allocate memory pool (%s)\n", strerror(errno));
+         exit(EXIT_FAILURE);
+     }
+}
+
+// Let the pool grow with extra segments when it runs out of space (and
+// release them again once they are entirely free). Off by default so a
+// fixed-size pool still fails allocations exactly like it always has.
+void mem_set_auto_grow(int enable) {
+     LOCK(&default_pool);
+     default_pool.auto_grow = enable;
+     UNLOCK(&default_pool);
+}
+
+// The compact sweep lives with the rest of the pool internals below
+static size_t pool_compact(mem_pool_t *p);
+
+// Switch the pool between eager coalescing (merge on every free, the
+// default) and lazy coalescing (frees just join their size class; runs
+// are merged in batch by the compact sweep). Turning lazy mode off
+// sweeps once so no unmerged runs are left behind.
+void mem_set_lazy_coalesce(int enable) {
+     LOCK(&default_pool);
+     default_pool.lazy_coalesce = enable;
+     if (!enable)
+         pool_compact(&default_pool);
+     UNLOCK(&default_pool);
+}
+
+// Merge every run of adjacent free blocks in one pass, on demand;
+// returns how many blocks were merged away. Useful between workload
+// phases when lazy coalescing is on, harmless (and a no-op) when the
+// eager frees have kept the pool merged already.
+size_t mem_compact(void) {
+     LOCK(&default_pool);
+     size_t merged = pool_compact(&default_pool);
+     UNLOCK(&default_pool);
+     return merged;
+}
+
+// Grow the pool enough to fit a request of the given size, if allowed
+// (pool mutex must be held)
+static int pool_grow(mem_pool_t *p, size_t need) {
+     if (!p->auto_grow)
+         return 0;
+     size_t seg_size = need > p->grow_quantum ? need : p->grow_quantum;
+     return segment_add(p, seg_size) != NULL;
+}
+
+// Hand a large freed range in an mmap segment back to the OS; its
+// pages fault back in zeroed on reuse (pool mutex must be held)
+static void block_madvise(MemBlock *curr) {
+     if (!curr->seg->is_mmap || curr->size < MADVISE_THRESHOLD)
+         return;
+     size_t page = (size_t)sysconf(_SC_PAGESIZE);
+     uintptr_t start = ((uintptr_t)block_ptr(curr) + page - 1) & ~(page - 1);
+     uintptr_t end   = ((uintptr_t)block_ptr(curr) + curr->size) & ~(page - 1);
+     if (end <= start)
+         return;
+     madvise((void *)start, end - start, MADV_DONTNEED);
+
+     // The dropped pages fault back in zeroed, so if the range reaches
+     // the dirty high-water mark, pull the mark down and mem_calloc
+     // gets to skip its memset here again
+     size_t rel_end = end - (uintptr_t)curr->seg->base;
+     size_t rel_start = start - (uintptr_t)curr->seg->base;
+     if (rel_end >= curr->seg->dirty_end && rel_start < curr->seg->dirty_end)
+         curr->seg->dirty_end = rel_start;
+}
+
+// One linear sweep merging every run of adjacent free blocks; this is
+// where all the coalescing happens in lazy mode. Returns how many
+// blocks were merged away (pool mutex must be held)
+static size_t pool_compact(mem_pool_t *p) {
+     p->lazy_frees = 0;
+     size_t merged = 0;
+     MemBlock *curr = p->block_list;
+     while (curr) {
+         // Step 1: Only the head of a free run starts a merge
+         if (!curr->is_free) {
+             curr = curr->next;
+             continue;
+         }
+
+         // Step 2: Absorb every free neighbor that follows in the same
+         // segment, exactly like the eager free's forward merge
+         int grew = 0;
+         while (curr->next && curr->next->is_free && curr->next->seg == curr->seg) {
+             MemBlock *next = curr->next;
+             free_remove(p, next);
+             hash_remove(p, next);
+             curr->size += next->size;
+             curr->next = next->next;
+             if (curr->next)
+                 curr->next->prev = curr;
+             block_release(p, next);
+             ++merged;
+             grew = 1;
+         }
+         if (!grew) {
+             curr = curr->next;
+             continue;
+         }
+
+         // Step 3: The merged block changed size class; re-index it,
+         // releasing a grown segment that turned entirely free
+         free_remove(p, curr);
+         MemBlock *after = curr->next;
+         if (p->auto_grow && curr->seg != segments_primary(p) &&
+             curr->offset == curr->seg->virt_start &&
+             curr->size   == curr->seg->size) {
+             segment_release(p, curr->seg, curr);
+         } else {
+             block_madvise(curr);
+             free_insert(p, curr);
+         }
+         curr = after;
+     }
+     return merged;
+}
+
+// Carve a block of the given size out of the pool, starting on an
+// address that is a multiple of align (pool mutex must be held, align
+// must be a power of two)
+static void *pool_alloc_aligned(mem_pool_t *p, size_t size, size_t align) {
+     // Step 1: Find a free block with room for the data plus whatever
+     // padding its address needs to reach the requested alignment. In
+     // lazy mode a failed scan earns one compact sweep and one retry:
+     // the space may exist as runs of unmerged neighbors.
+     MemBlock *curr = NULL;
+     size_t pad = 0;
+     for (int attempt = 0; attempt < 2 && !curr; ++attempt) {
+         for (int cls = size_class(size); cls < NUM_SIZE_CLASSES && !curr; ++cls) {
+             for (MemBlock *b = p->free_lists[cls]; b; b = b->next_free) {
+                 uintptr_t base = (uintptr_t)block_ptr(b);
+                 size_t pd = (align - (base & (align - 1))) & (align - 1);
+                 if (b->size >= size + pd) {
+                     curr = b;
+                     pad = pd;
+                     break;
+                 }
              }
          }
-         UNLOCK();
-         return NULL;
+         if (!curr && (attempt > 0 || !p->lazy_coalesce || pool_compact(p) == 0))
+             break;
+     }
+     if (!curr)
+         return NULL; // No memory available
+     free_remove(p, curr);
+
+     // Step 2: Split the padding off the front so it stays allocatable;
+     // the aligned remainder becomes the block we hand out
+     if (pad > 0) {
+         MemBlock *rest = block_new(p);
+         if (!rest) {
+             free_insert(p, curr);
+             return NULL;
+         }
+         rest->offset  = curr->offset + pad;
+         rest->size    = curr->size - pad;
+         rest->is_free = 1;
+         rest->seg     = curr->seg;
+         rest->next    = curr->next;
+         rest->prev    = curr;
+         if (rest->next)
+             rest->next->prev = rest;
+         hash_insert(p, rest);
+
+         curr->size = pad;
+         curr->next = rest;
+         free_insert(p, curr); // The padding stays a free block
+         curr = rest;
+     }
+
+     // Step 3: If the block is bigger than needed, split it
+     if (curr->size > size) {
+         MemBlock *new_block = block_new(p);
+         if (!new_block) {
+             free_insert(p, curr);
+             return NULL;
+         }
+
+         // Step 4: Create new block for leftover space
+         new_block->offset  = curr->offset + size;
+         new_block->size    = curr->size - size;
+         new_block->is_free = 1;
+         new_block->seg     = curr->seg;
+         new_block->next    = curr->next;
+         new_block->prev    = curr;
+         if (new_block->next)
+             new_block->next->prev = new_block;
+         free_insert(p, new_block);
+         hash_insert(p, new_block);
+
+         // Step 5: Update current block
+         curr->size    = size;
+         curr->is_free = 0;
+         curr->next    = new_block;
+     } else {
+         // Step 6: Exact fit, mark as used
+         curr->is_free = 0;
+     }
+
+     // Step 7: Track the segment's dirty high-water mark so mem_calloc
+     // knows whether the block still holds untouched zero pages
+     PoolSegment *seg = curr->seg;
+     size_t rel = curr->offset - seg->virt_start;
+     p->last_alloc_zero = seg->is_mmap && rel >= seg->dirty_end;
+     if (rel + curr->size > seg->dirty_end)
+         seg->dirty_end = rel + curr->size;
+
+     // Step 8: Return pointer to start of the block
+     return block_ptr(curr);
+}
+
+// Carve a block with no particular alignment (pool mutex must be held)
+static void *pool_alloc(mem_pool_t *p, size_t size) {
+     return pool_alloc_aligned(p, size, 1);
+}
+
+// Return a block to the pool and merge neighbors (pool mutex must be held)
+static void pool_free(mem_pool_t *p, void *ptr) {
+     // Step 1: Resolve the pointer straight to its block
+     PoolSegment *seg = segment_of(p, ptr);
+     if (!seg)
+         return;
+     MemBlock *curr = hash_lookup(p, seg->virt_start + ((char *)ptr - seg->base));
+     if (!curr)
+         return;
+
+     // Step 2: Already free? Do nothing
+     if (curr->is_free) return;
+
+     // Step 3: Mark block as free
+     curr->is_free = 1;
+
+     // Step 3b: In lazy mode that is all the hot path does — the block
+     // joins its size class unmerged and the compact sweep picks up the
+     // merging later (at the watermark, on allocation pressure, or via
+     // mem_compact). Grown-segment release and madvise wait until then
+     // too, since both want the fully merged run.
+     if (p->lazy_coalesce) {
+         free_insert(p, curr);
+         if (++p->lazy_frees >= MEM_COMPACT_WATERMARK)
+             pool_compact(p);
+         return;
+     }
+
+     // Step 4: Merge with next block if next block is free
+     if (curr->next && curr->next->is_free && curr->next->seg == curr->seg) {
+         MemBlock *next = curr->next;
+         free_remove(p, next);
+         hash_remove(p, next);
+         curr->size += next->size;
+         curr->next = next->next;
+         if (curr->next)
+             curr->next->prev = curr;
+         block_release(p, next);
+     }
+
+     // Step 5: Merge with previous block if it’s free; the prev link
+     // makes neighbor discovery constant time
+     MemBlock *prev = curr->prev;
+     if (prev && prev->is_free && prev->seg == curr->seg) {
+         free_remove(p, prev);
+         hash_remove(p, curr);
+         prev->size += curr->size;
+         prev->next  = curr->next;
+         if (prev->next)
+             prev->next->prev = prev;
+         block_release(p, curr);
+         curr = prev;
      }
-     // Step 2: Look for a big enough "free" block
-     for (MemBlock *curr = block_list; curr; curr = curr->next) {
-         if (!curr->is_free || curr->size < size) continue;
- 
-         // Step 3: If the block is bigger than needed, split it
+
+     // Step 6: A grown segment that is entirely free again goes back to
+     // the system (the primary segment always stays)
+     if (p->auto_grow && curr->seg != segments_primary(p) &&
+         curr->offset == curr->seg->virt_start &&
+         curr->size   == curr->seg->size) {
+         segment_release(p, curr->seg, curr);
+         return;
+     }
+
+     // Step 7: In an mmap-backed segment, tell the OS it can drop the
+     // pages of a large freed range; they fault back in zeroed on reuse
+     block_madvise(curr);
+
+     // Step 8: Index the merged block for future allocations
+     free_insert(p, curr);
+}
+
+// Try to grow or shrink a block where it sits; returns ptr on success,
+// NULL if the data has to move (pool mutex must be held)
+static void *pool_resize_inplace(mem_pool_t *p, MemBlock *curr, void *ptr, size_t size) {
+     // Step 1: If the block is already big enough, shrink it if needed
+     if (curr->size >= size) {
          if (curr->size > size) {
-             MemBlock *new_block = malloc(sizeof(MemBlock));
-             if (!new_block) {
-                 UNLOCK();
+             // Create a new free block with leftover space
+             MemBlock *new_block = block_new(p);
+             if (!new_block)
                  return NULL;
-             }
- 
-             // Step 4: Create new block for leftover space
+
              new_block->offset  = curr->offset + size;
              new_block->size    = curr->size - size;
              new_block->is_free = 1;
+             new_block->seg     = curr->seg;
              new_block->next    = curr->next;
- 
-             // Step 5: Update current block
-             curr->size    = size;
-             curr->is_free = 0;
-             curr->next    = new_block;
-         } else {
-             // Step 6: Exact fit, mark as used
-             curr->is_free = 0;
+             new_block->prev    = curr;
+             if (new_block->next)
+                 new_block->next->prev = new_block;
+             free_insert(p, new_block);
+             hash_insert(p, new_block);
+
+             curr->size = size;
+             curr->next = new_block;
+         }
+         return ptr; // Done shrinking
+     }
+
+     // Step 2: Try to expand into the next block if it’s free, big
+     // enough, and backed by the same segment
+     if (curr->next && curr->next->is_free && curr->next->seg == curr->seg &&
+         curr->size + curr->next->size >= size) {
+
+         // Merge current and next block
+         MemBlock *next = curr->next;
+         free_remove(p, next);
+         hash_remove(p, next);
+         curr->size += next->size;
+         curr->next  = next->next;
+         if (curr->next)
+             curr->next->prev = curr;
+         block_release(p, next);
+
+         // If there's still extra space, split again
+         if (curr->size > size) {
+             MemBlock *new_block = block_new(p);
+             if (!new_block)
+                 return NULL;
+
+             new_block->offset  = curr->offset + size;
+             new_block->size    = curr->size - size;
+             new_block->is_free = 1;
+             new_block->seg     = curr->seg;
+             new_block->next    = curr->next;
+             new_block->prev    = curr;
+             if (new_block->next)
+                 new_block->next->prev = new_block;
+             free_insert(p, new_block);
+             hash_insert(p, new_block);
+
+             curr->size = size;
+             curr->next = new_block;
          }
- 
-         // Step 7: Return pointer to start of the block
-         void *ptr = memory_pool + curr->offset;
-         UNLOCK();
          return ptr;
      }
- 
-     // Step 8: If we got here, no memory available
-     UNLOCK();
+
+     // Step 3: No room where it sits; the caller has to move the data
      return NULL;
 }
 
-//Free a block of memory and merge with neighbors if possible
-void mem_free(void *ptr) {
-     if (!ptr) return;
- 
-     LOCK();
-     // Step 1: Find the block that matches the pointer
-     size_t offset = (char *)ptr - memory_pool;
-     MemBlock *prev = NULL;
- 
-     for (MemBlock *curr = block_list; curr; curr = curr->next) {
-         if (curr->offset != offset) {
-             prev = curr;
-             continue;
+// ---- Thread-caching front end -------------------------------------------
+// Each thread keeps small per-size-class magazines of blocks it freed
+// recently, plus a table of its own recent small allocations so a free
+// can figure out the block size without the global mutex. The common
+// alloc/free pair is then served entirely from the thread's own cache.
+// Whenever the shared pool runs out of space it reclaims every cache and
+// retries, so cached blocks never make an allocation fail that would
+// have succeeded before. The caches front the default pool only; handle
+// pools created with mem_pool_create go straight to their own lock,
+// which is already private to whoever uses that pool.
+
+#define CACHE_MAX_SIZE   256   // Only allocations this small are cached
+#define CACHE_CLASSES     16   // Size classes covering 1..CACHE_MAX_SIZE
+#define CACHE_MAG_CAP      8   // Cached blocks per size class
+#define LIVE_TABLE_SLOTS  64   // Recent own allocations we can free locklessly
+#define LIVE_TABLE_PROBES  8   // How far the open-addressed table probes
+
+#define LIVE_TOMBSTONE ((void *)-1) // Marks a deleted live-table slot
+
+typedef struct ThreadCache {
+     struct ThreadCache *next;                    // Next cache in the registry
+     pthread_mutex_t lock;                        // Guards everything below
+     void    *mag_ptr [CACHE_CLASSES][CACHE_MAG_CAP]; // Cached free blocks
+     size_t   mag_size[CACHE_CLASSES][CACHE_MAG_CAP]; // Their exact sizes
+     int      mag_count[CACHE_CLASSES];           // Blocks cached per class
+     void    *live_ptr [LIVE_TABLE_SLOTS];        // Recent own allocations
+     size_t   live_size[LIVE_TABLE_SLOTS];        // Their exact sizes
+     unsigned long hits;                          // Allocs served from the cache
+     unsigned long frees;                         // Frees absorbed by the cache
+} ThreadCache;
+
+static ThreadCache    *cache_registry = NULL;    // Every live thread's cache
+static pthread_mutex_t cache_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t   cache_key;                // TLS slot for the cache
+static pthread_once_t  cache_key_once = PTHREAD_ONCE_INIT;
+static unsigned long   cache_miss_count = 0;     // Allocs that hit the pool (pool mutex)
+static unsigned long   cache_hits_retired = 0;   // Hits from exited threads (registry mutex)
+static unsigned long   cache_frees_retired = 0;  // Cached frees from exited threads
+
+// Lock order everywhere: pool mutex -> cache_registry_mutex -> cache lock.
+
+static void cache_thread_exit(void *arg);
+
+// One-time creation of the TLS key
+static void cache_key_create(void) {
+     pthread_key_create(&cache_key, cache_thread_exit);
+}
+
+// Get (or lazily create and register) the calling thread's cache
+static ThreadCache *get_cache(void) {
+     pthread_once(&cache_key_once, cache_key_create);
+     ThreadCache *tc = pthread_getspecific(cache_key);
+     if (tc)
+         return tc;
+
+     // Step 1: First time this thread allocates; build its cache
+     tc = calloc(1, sizeof(ThreadCache));
+     if (!tc)
+         return NULL;
+     pthread_mutex_init(&tc->lock, NULL);
+     pthread_setspecific(cache_key, tc);
+
+     // Step 2: Register it so the pool can reclaim it under pressure
+     pthread_mutex_lock(&cache_registry_mutex);
+     tc->next = cache_registry;
+     cache_registry = tc;
+     pthread_mutex_unlock(&cache_registry_mutex);
+     return tc;
+}
+
+// Remember one of our own allocations (cache lock must be held)
+static void live_record(ThreadCache *tc, void *ptr, size_t size) {
+     size_t idx = ((size_t)(uintptr_t)ptr >> 4) % LIVE_TABLE_SLOTS;
+     for (int i = 0; i < LIVE_TABLE_PROBES; ++i) {
+         size_t s = (idx + i) % LIVE_TABLE_SLOTS;
+         if (!tc->live_ptr[s] || tc->live_ptr[s] == LIVE_TOMBSTONE ||
+             tc->live_ptr[s] == ptr) {
+             tc->live_ptr[s]  = ptr;
+             tc->live_size[s] = size;
+             return;
          }
- 
-         // Step 2: Already free? Do nothing
-         if (curr->is_free) { UNLOCK(); return; }
- 
-         // Step 3: Mark block as free
-         curr->is_free = 1;
- 
-         // Step 4: Merge with next block if next block is free
-         if (curr->next && curr->next->is_free) {
-             MemBlock *next = curr->next;
-             curr->size += next->size;
-             curr->next = next->next;
-             free(next);
+     }
+     // Table is crowded here; this allocation just frees the slow way
+}
+
+// Look up and remove one of our allocations (cache lock must be held)
+static int live_take(ThreadCache *tc, void *ptr, size_t *size_out) {
+     size_t idx = ((size_t)(uintptr_t)ptr >> 4) % LIVE_TABLE_SLOTS;
+     for (int i = 0; i < LIVE_TABLE_PROBES; ++i) {
+         size_t s = (idx + i) % LIVE_TABLE_SLOTS;
+         if (!tc->live_ptr[s])
+             return 0;
+         if (tc->live_ptr[s] == ptr) {
+             tc->live_ptr[s] = LIVE_TOMBSTONE;
+             *size_out = tc->live_size[s];
+             return 1;
+         }
+     }
+     return 0;
+}
+
+// Drop every cached block back into the default pool (its mutex and the
+// cache lock must be held)
+static void cache_flush(ThreadCache *tc) {
+     for (int cls = 0; cls < CACHE_CLASSES; ++cls) {
+         for (int i = 0; i < tc->mag_count[cls]; ++i)
+             pool_free(&default_pool, tc->mag_ptr[cls][i]);
+         tc->mag_count[cls] = 0;
+     }
+}
+
+// Flush every registered cache back into the pool (default pool mutex
+// must be held). Called when the pool looks full, before giving up on
+// an allocation.
+static void reclaim_caches(void) {
+     pthread_mutex_lock(&cache_registry_mutex);
+     for (ThreadCache *tc = cache_registry; tc; tc = tc->next) {
+         pthread_mutex_lock(&tc->lock);
+         cache_flush(tc);
+         pthread_mutex_unlock(&tc->lock);
+     }
+     pthread_mutex_unlock(&cache_registry_mutex);
+}
+
+// Make every cache forget about ptr (default pool mutex must be held).
+// Returns 1 if ptr was cached in a magazine, meaning it is already
+// logically free. Needed so a free or resize done by a different thread
+// than the one that allocated never leaves a stale cache entry behind.
+static int cache_forget(void *ptr) {
+     int was_cached = 0;
+     pthread_mutex_lock(&cache_registry_mutex);
+     for (ThreadCache *tc = cache_registry; tc; tc = tc->next) {
+         pthread_mutex_lock(&tc->lock);
+
+         // Step 1: Tombstone any live-table entry for ptr
+         size_t idx = ((size_t)(uintptr_t)ptr >> 4) % LIVE_TABLE_SLOTS;
+         for (int i = 0; i < LIVE_TABLE_PROBES; ++i) {
+             size_t s = (idx + i) % LIVE_TABLE_SLOTS;
+             if (tc->live_ptr[s] == ptr) {
+                 tc->live_ptr[s] = LIVE_TOMBSTONE;
+                 break;
+             }
+         }
+
+         // Step 2: Pull ptr out of the magazines if it sits there
+         for (int cls = 0; cls < CACHE_CLASSES && !was_cached; ++cls) {
+             for (int i = 0; i < tc->mag_count[cls]; ++i) {
+                 if (tc->mag_ptr[cls][i] == ptr) {
+                     int last = --tc->mag_count[cls];
+                     tc->mag_ptr[cls][i]  = tc->mag_ptr[cls][last];
+                     tc->mag_size[cls][i] = tc->mag_size[cls][last];
+                     was_cached = 1;
+                     break;
+                 }
+             }
          }
- 
-         // Step 5: Merge with previous block if it’s free
-         if (prev && prev->is_free) {
-             prev->size += curr->size;
-             prev->next  = curr->next;
-             free(curr);
+         pthread_mutex_unlock(&tc->lock);
+     }
+     pthread_mutex_unlock(&cache_registry_mutex);
+     return was_cached;
+}
+
+// Drop all cached state without touching the pool (default pool mutex
+// must be held). Used by mem_deinit, where the pool is going away anyway.
+static void cache_drop_all(void) {
+     pthread_mutex_lock(&cache_registry_mutex);
+     for (ThreadCache *tc = cache_registry; tc; tc = tc->next) {
+         pthread_mutex_lock(&tc->lock);
+         memset(tc->mag_count, 0, sizeof(tc->mag_count));
+         memset(tc->live_ptr, 0, sizeof(tc->live_ptr));
+         pthread_mutex_unlock(&tc->lock);
+     }
+     pthread_mutex_unlock(&cache_registry_mutex);
+}
+
+// TLS destructor: give cached blocks back and unregister the cache
+static void cache_thread_exit(void *arg) {
+     ThreadCache *tc = arg;
+
+     // Step 1: Unlink from the registry, keeping its counters for the stats
+     pthread_mutex_lock(&cache_registry_mutex);
+     for (ThreadCache **pp = &cache_registry; *pp; pp = &(*pp)->next) {
+         if (*pp == tc) {
+             *pp = tc->next;
+             break;
+         }
+     }
+     cache_hits_retired  += tc->hits;
+     cache_frees_retired += tc->frees;
+     pthread_mutex_unlock(&cache_registry_mutex);
+
+     // Step 2: Return cached blocks to the pool, if it still exists
+     LOCK(&default_pool);
+     if (default_pool.segments)
+         cache_flush(tc);
+     UNLOCK(&default_pool);
+
+     // Step 3: Tear the cache down
+     pthread_mutex_destroy(&tc->lock);
+     free(tc);
+}
+
+// Try to find space and give the user a pointer to it
+void *mem_alloc(size_t size) {
+     mem_pool_t *p = &default_pool;
+     hist_record(p, size, 1);
+
+     // Step 1: Small sizes first try the calling thread's own cache
+     ThreadCache *tc = NULL;
+     if (size > 0 && size <= CACHE_MAX_SIZE && (tc = get_cache())) {
+         int cls = size_class(size);
+         pthread_mutex_lock(&tc->lock);
+         for (int i = 0; i < tc->mag_count[cls]; ++i) {
+             if (tc->mag_size[cls][i] != size)
+                 continue;
+
+             // Cache hit: hand the block straight back out
+             void *ptr = tc->mag_ptr[cls][i];
+             int last = --tc->mag_count[cls];
+             tc->mag_ptr[cls][i]  = tc->mag_ptr[cls][last];
+             tc->mag_size[cls][i] = tc->mag_size[cls][last];
+             live_record(tc, ptr, size);
+             ++tc->hits;
+             pthread_mutex_unlock(&tc->lock);
+             return ptr;
+         }
+         pthread_mutex_unlock(&tc->lock);
+     }
+
+     LOCK(p);
+     // Step 2: Special case; if size is 0, return any free block if there is one
+     if (size == 0) {
+         for (int pass = 0; pass < 2; ++pass) {
+             for (int cls = 0; cls < NUM_SIZE_CLASSES; ++cls) {
+                 if (p->free_lists[cls]) {
+                     void *ptr = block_ptr(p->free_lists[cls]);
+                     UNLOCK(p);
+                     return ptr;
+                 }
+             }
+             // Everything might be sitting in thread caches; pull it back
+             reclaim_caches();
+         }
+         UNLOCK(p);
+         return NULL;
+     }
+
+     // Step 3: Carve a block from the shared pool
+     void *ptr = pool_alloc(p, size);
+
+     // Step 4: If the pool looks full, reclaim the thread caches and
+     // retry; as a last resort let the pool grow a segment if allowed
+     if (!ptr) {
+         reclaim_caches();
+         ptr = pool_alloc(p, size);
+     }
+     if (!ptr && pool_grow(p, size))
+         ptr = pool_alloc(p, size);
+     if (ptr)
+         ++p->stat_alloc_count;
+     else
+         ++p->stat_failed_allocs;
+
+     // Step 5: Remember the allocation so this thread can free it locklessly
+     if (ptr && tc) {
+         ++cache_miss_count;
+         pthread_mutex_lock(&tc->lock);
+         live_record(tc, ptr, size);
+         pthread_mutex_unlock(&tc->lock);
+     }
+     UNLOCK(p);
+     return ptr;
+}
+
+// Like mem_alloc, but the returned pointer is aligned to align bytes
+void *mem_alloc_aligned(size_t size, size_t align) {
+     mem_pool_t *p = &default_pool;
+
+     // Step 1: Trivial alignments take the ordinary (thread-cached) path
+     if (align <= 1 || size == 0)
+         return mem_alloc(size);
+
+     // Step 2: Only power-of-two alignments make sense
+     if (align & (align - 1))
+         return NULL;
+     hist_record(p, size, 1);
+
+     LOCK(p);
+     // Step 3: Carve an aligned block from the shared pool
+     void *ptr = pool_alloc_aligned(p, size, align);
+
+     // Step 4: If the pool looks full, reclaim the thread caches and
+     // retry; as a last resort let the pool grow a segment if allowed
+     if (!ptr) {
+         reclaim_caches();
+         ptr = pool_alloc_aligned(p, size, align);
+     }
+     if (!ptr && pool_grow(p, size + align))
+         ptr = pool_alloc_aligned(p, size, align);
+     if (ptr)
+         ++p->stat_alloc_count;
+     else
+         ++p->stat_failed_allocs;
+     UNLOCK(p);
+     return ptr;
+}
+
+// Like calloc: allocate nmemb * size zeroed bytes. Blocks carved out of
+// pages the pool never wrote to (fresh mmap pages, or ranges dropped
+// with MADV_DONTNEED) are zero already and skip the memset, so large
+// callocs from an mmap-backed pool cost no page touches up front.
+void *mem_calloc(size_t nmemb, size_t size) {
+     mem_pool_t *p = &default_pool;
+
+     // Step 1: Refuse a product that overflows size_t
+     if (size != 0 && nmemb > (size_t)-1 / size)
+         return NULL;
+     size_t total = nmemb * size;
+     if (total == 0)
+         return mem_alloc(0);
+     hist_record(p, total, 1);
+
+     // Step 2: Carve from the shared pool; the thread caches are skipped
+     // on purpose, a recycled cache block always holds old data
+     LOCK(p);
+     void *ptr = pool_alloc(p, total);
+     if (!ptr) {
+         reclaim_caches();
+         ptr = pool_alloc(p, total);
+     }
+     if (!ptr && pool_grow(p, total))
+         ptr = pool_alloc(p, total);
+     int zeroed = ptr && p->last_alloc_zero;
+     if (ptr)
+         ++p->stat_alloc_count;
+     else
+         ++p->stat_failed_allocs;
+     UNLOCK(p);
+
+     // Step 3: Only a block from already-dirtied memory needs the memset
+     if (ptr && !zeroed)
+         memset(ptr, 0, total);
+     return ptr;
+}
+
+// Allocate count blocks of the same size under one lock acquisition
+size_t mem_alloc_batch(size_t size, size_t count, void **out) {
+     mem_pool_t *p = &default_pool;
+     if (!out || size == 0 || count == 0)
+         return 0;
+     hist_record(p, size, count);
+
+     LOCK(p);
+     // Step 1: Carve the whole batch while holding the lock once; the
+     // repeated splits walk down a single free block, so a burst comes
+     // out of one or a few contiguous regions
+     size_t done = 0;
+     while (done < count) {
+         void *ptr = pool_alloc(p, size);
+         if (!ptr) {
+             // Pool looks full; pull back the thread caches and retry,
+             // growing the pool if that is allowed
+             reclaim_caches();
+             ptr = pool_alloc(p, size);
+             if (!ptr && pool_grow(p, size * (count - done)))
+                 ptr = pool_alloc(p, size);
+             if (!ptr)
+                 break;
          }
-        
-        
-         UNLOCK();
+         out[done++] = ptr;
+     }
+
+     // Step 2: All or nothing; a half-filled batch goes straight back
+     if (done < count) {
+         while (done > 0)
+             pool_free(p, out[--done]);
+         ++p->stat_failed_allocs;
+         UNLOCK(p);
+         return 0;
+     }
+     p->stat_alloc_count += count;
+     UNLOCK(p);
+
+     // Step 3: Remember small blocks so this thread can free them locklessly
+     ThreadCache *tc;
+     if (size <= CACHE_MAX_SIZE && (tc = get_cache())) {
+         pthread_mutex_lock(&tc->lock);
+         for (size_t i = 0; i < count; ++i)
+             live_record(tc, out[i], size);
+         pthread_mutex_unlock(&tc->lock);
+     }
+     return count;
+}
+
+// Free count blocks under one lock acquisition, coalescing as it goes
+void mem_free_batch(void **ptrs, size_t count) {
+     mem_pool_t *p = &default_pool;
+     if (!ptrs || count == 0)
          return;
+
+     LOCK(p);
+     for (size_t i = 0; i < count; ++i) {
+         if (!ptrs[i])
+             continue;
+         // Same bookkeeping as mem_free, minus the per-call lock churn
+         cache_forget(ptrs[i]);
+         pool_free(p, ptrs[i]);
+         ++p->stat_free_count;
      }
-     UNLOCK();
+     UNLOCK(p);
 }
- 
+
+//Free a block of memory and merge with neighbors if possible
+void mem_free(void *ptr) {
+     mem_pool_t *p = &default_pool;
+     if (!ptr) return;
+
+     // Step 1: If this thread allocated it, park it in the thread cache
+     ThreadCache *tc = get_cache();
+     if (tc) {
+         size_t size;
+         pthread_mutex_lock(&tc->lock);
+         if (live_take(tc, ptr, &size)) {
+             int cls = size_class(size);
+             if (tc->mag_count[cls] < CACHE_MAG_CAP) {
+                 int n = tc->mag_count[cls]++;
+                 tc->mag_ptr[cls][n]  = ptr;
+                 tc->mag_size[cls][n] = size;
+                 ++tc->frees;
+                 pthread_mutex_unlock(&tc->lock);
+                 return;
+             }
+         }
+         pthread_mutex_unlock(&tc->lock);
+     }
+
+     LOCK(p);
+     // Step 2: Make sure no cache still references ptr; a stale entry
+     // would let a magazine hand the block out again after this free
+     cache_forget(ptr);
+
+     // Step 3: Return the block to the pool
+     pool_free(p, ptr);
+     ++p->stat_free_count;
+     UNLOCK(p);
+}
+
 // Change the size of a block
 void *mem_resize(void *ptr, size_t size) {
+    mem_pool_t *p = &default_pool;
+
     // Step 1: If the pointer is NULL, allocate new memory
     if (!ptr) return mem_alloc(size);
 
@@ -166,69 +1256,30 @@ void *mem_resize(void *ptr, size_t size) {
         return NULL;
     }
 
-    LOCK();
-    // Step 3: Calculate the offset for the block and find it in the block list
-    size_t offset = (char *)ptr - memory_pool;
-    for (MemBlock *curr = block_list; curr; curr = curr->next) {
-        if (curr->offset != offset) continue;
-
-        // Step 4: If the block is already big enough, shrink it if needed
-        if (curr->size >= size) {
-            if (curr->size > size) {
-                // Create a new free block with leftover space
-                MemBlock *new_block = malloc(sizeof(MemBlock));
-                if (!new_block) {
-                    UNLOCK();
-                    return NULL;
-                }
-
-                new_block->offset  = curr->offset + size;
-                new_block->size    = curr->size - size;
-                new_block->is_free = 1;
-                new_block->next    = curr->next;
-
-                curr->size = size;
-                curr->next = new_block;
-            }
+    hist_record(p, size, 1);
+    LOCK(p);
+    ++p->stat_resize_count;
 
-            UNLOCK();
-            return ptr; // Done shrinking, return pointer
-        }
+    // Step 3: The block's size is about to change, so no thread cache may
+    // keep serving frees or hits for the old pointer
+    cache_forget(ptr);
 
-        // Step 5: Try to expand into the next block if it’s free and big enough
-        if (curr->next && curr->next->is_free &&
-            curr->size + curr->next->size >= size) {
-
-            // Merge current and next block
-            MemBlock *next = curr->next;
-            curr->size += next->size;
-            curr->next  = next->next;
-            free(next);
-
-            // If there's still extra space, split again
-            if (curr->size > size) {
-                MemBlock *new_block = malloc(sizeof(MemBlock));
-                if (!new_block) {
-                    UNLOCK();
-                    return NULL;
-                }
-
-                new_block->offset  = curr->offset + size;
-                new_block->size    = curr->size - size;
-                new_block->is_free = 1;
-                new_block->next    = curr->next;
-
-                curr->size = size;
-                curr->next = new_block;
+    // Step 4: Resolve the pointer straight to its block
+    PoolSegment *seg = segment_of(p, ptr);
+    MemBlock *curr = seg ? hash_lookup(p, seg->virt_start + ((char *)ptr - seg->base)) : NULL;
+    if (curr) {
+        // Step 5: Shrink or expand the block where it sits if possible
+        if (curr->size >= size || (curr->next && curr->next->is_free)) {
+            void *done = pool_resize_inplace(p, curr, ptr, size);
+            if (done || curr->size >= size) {
+                UNLOCK(p);
+                return done;
             }
-           
-            UNLOCK();
-            return ptr; // Return pointer
         }
 
         // Step 6: Can't resize in place, so allocate new memory
         size_t old_size = curr->size;
-        UNLOCK(); // Unlock before doing a new allocation
+        UNLOCK(p); // Unlock before doing a new allocation
 
         // Allocate a new block
         void *new_ptr = mem_alloc(size);
@@ -244,27 +1295,519 @@ void *mem_resize(void *ptr, size_t size) {
     }
 
     // Step 7: Block was not found in the list
-    UNLOCK();
+    UNLOCK(p);
     return NULL;
 }
 
+// ---- Handle-based pool API ----------------------------------------------
+// Every function below is the pool-argument twin of a global mem_*
+// call, minus the thread-cache front end: a handle pool is expected to
+// be owned by one subsystem, so its own mutex is already uncontended
+// and the extra cache layer would only hide memory from its owner.
+
+// Create an independent pool of the given size; NULL if out of memory
+mem_pool_t *mem_pool_create(size_t size) {
+     mem_pool_t *p = calloc(1, sizeof(mem_pool_t));
+     if (!p)
+         return NULL;
+     pthread_mutex_init(&p->mutex, NULL);
+     if (!pool_setup(p, size, 0)) {
+         pthread_mutex_destroy(&p->mutex);
+         free(p);
+         return NULL;
+     }
+     return p;
+}
+
+// Destroy a pool and everything in it; O(1) in the number of blocks
+void mem_pool_destroy(mem_pool_t *pool) {
+     if (!pool)
+         return;
+     LOCK(pool);
+     pool_teardown(pool);
+     UNLOCK(pool);
+     pthread_mutex_destroy(&pool->mutex);
+     free(pool);
+}
+
+// Let a handle pool grow on demand, like mem_set_auto_grow
+void mem_pool_set_auto_grow(mem_pool_t *pool, int enable) {
+     if (!pool)
+         return;
+     LOCK(pool);
+     pool->auto_grow = enable;
+     UNLOCK(pool);
+}
+
+// Lazy coalescing for a handle pool, like mem_set_lazy_coalesce
+void mem_pool_set_lazy_coalesce(mem_pool_t *pool, int enable) {
+     if (!pool) {
+         mem_set_lazy_coalesce(enable);
+         return;
+     }
+     LOCK(pool);
+     pool->lazy_coalesce = enable;
+     if (!enable)
+         pool_compact(pool);
+     UNLOCK(pool);
+}
+
+// mem_compact against a handle pool
+size_t mem_compact_from(mem_pool_t *pool) {
+     if (!pool)
+         return mem_compact();
+     LOCK(pool);
+     size_t merged = pool_compact(pool);
+     UNLOCK(pool);
+     return merged;
+}
+
+// mem_alloc against a handle pool
+void *mem_alloc_from(mem_pool_t *pool, size_t size) {
+     if (!pool)
+         return mem_alloc(size);
+     hist_record(pool, size, 1);
+
+     LOCK(pool);
+     // Step 1: Special case; if size is 0, return any free block if there is one
+     if (size == 0) {
+         for (int cls = 0; cls < NUM_SIZE_CLASSES; ++cls) {
+             if (pool->free_lists[cls]) {
+                 void *ptr = block_ptr(pool->free_lists[cls]);
+                 UNLOCK(pool);
+                 return ptr;
+             }
+         }
+         UNLOCK(pool);
+         return NULL;
+     }
+
+     // Step 2: Carve a block, growing the pool if that is allowed
+     void *ptr = pool_alloc(pool, size);
+     if (!ptr && pool_grow(pool, size))
+         ptr = pool_alloc(pool, size);
+     if (ptr)
+         ++pool->stat_alloc_count;
+     else
+         ++pool->stat_failed_allocs;
+     UNLOCK(pool);
+     return ptr;
+}
+
+// mem_alloc_batch against a handle pool; all or nothing, like the global
+size_t mem_alloc_batch_from(mem_pool_t *pool, size_t size, size_t count, void **out) {
+     if (!pool)
+         return mem_alloc_batch(size, count, out);
+     if (!out || size == 0 || count == 0)
+         return 0;
+     hist_record(pool, size, count);
+
+     LOCK(pool);
+     size_t done = 0;
+     while (done < count) {
+         void *ptr = pool_alloc(pool, size);
+         if (!ptr && pool_grow(pool, size * (count - done)))
+             ptr = pool_alloc(pool, size);
+         if (!ptr)
+             break;
+         out[done++] = ptr;
+     }
+     if (done < count) {
+         while (done > 0)
+             pool_free(pool, out[--done]);
+         ++pool->stat_failed_allocs;
+         UNLOCK(pool);
+         return 0;
+     }
+     pool->stat_alloc_count += count;
+     UNLOCK(pool);
+     return count;
+}
+
+// mem_free against a handle pool
+void mem_free_from(mem_pool_t *pool, void *ptr) {
+     if (!pool) {
+         mem_free(ptr);
+         return;
+     }
+     if (!ptr)
+         return;
+     LOCK(pool);
+     pool_free(pool, ptr);
+     ++pool->stat_free_count;
+     UNLOCK(pool);
+}
+
+// mem_resize against a handle pool
+void *mem_resize_from(mem_pool_t *pool, void *ptr, size_t size) {
+     if (!pool)
+         return mem_resize(ptr, size);
+     if (!ptr)
+         return mem_alloc_from(pool, size);
+     if (size == 0) {
+         mem_free_from(pool, ptr);
+         return NULL;
+     }
+
+     hist_record(pool, size, 1);
+     LOCK(pool);
+     ++pool->stat_resize_count;
+
+     // Step 1: Resolve the pointer and try to resize it where it sits
+     PoolSegment *seg = segment_of(pool, ptr);
+     MemBlock *curr = seg ? hash_lookup(pool, seg->virt_start + ((char *)ptr - seg->base)) : NULL;
+     if (!curr) {
+         UNLOCK(pool);
+         return NULL;
+     }
+     if (curr->size >= size || (curr->next && curr->next->is_free)) {
+         void *done = pool_resize_inplace(pool, curr, ptr, size);
+         if (done || curr->size >= size) {
+             UNLOCK(pool);
+             return done;
+         }
+     }
+
+     // Step 2: The data has to move to a fresh block
+     size_t old_size = curr->size;
+     UNLOCK(pool);
+
+     void *new_ptr = mem_alloc_from(pool, size);
+     if (!new_ptr)
+         return NULL;
+     memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+     mem_free_from(pool, ptr);
+     return new_ptr;
+}
+
+// Shared body of mem_stats and mem_stats_from; with_caches adds the
+// thread-cache counters, which only make sense for the default pool
+static void stats_fill(mem_pool_t *p, mem_stats_t *out, int with_caches) {
+     LOCK(p);
+     // Step 1: Walk the block chain for the space numbers
+     out->pool_size = p->pool_size;
+     for (MemBlock *b = p->block_list; b; b = b->next) {
+         ++out->block_count;
+         if (b->is_free) {
+             out->free_bytes += b->size;
+             if (b->size > out->largest_free)
+                 out->largest_free = b->size;
+         } else {
+             out->used_bytes += b->size;
+         }
+     }
+     for (PoolSegment *seg = p->segments; seg; seg = seg->next)
+         ++out->segment_count;
+
+     // Step 2: Copy the operation counters
+     out->alloc_count     = p->stat_alloc_count;
+     out->free_count      = p->stat_free_count;
+     out->resize_count    = p->stat_resize_count;
+     out->failed_allocs   = p->stat_failed_allocs;
+     out->lock_contention = p->stat_lock_contention;
+
+     // Step 3: Sum the per-thread cache counters
+     if (with_caches) {
+         out->cache_misses = cache_miss_count;
+         pthread_mutex_lock(&cache_registry_mutex);
+         out->cache_hits  = cache_hits_retired;
+         out->cache_frees = cache_frees_retired;
+         for (ThreadCache *tc = cache_registry; tc; tc = tc->next) {
+             pthread_mutex_lock(&tc->lock);
+             out->cache_hits  += tc->hits;
+             out->cache_frees += tc->frees;
+             pthread_mutex_unlock(&tc->lock);
+         }
+         pthread_mutex_unlock(&cache_registry_mutex);
+     }
+     UNLOCK(p);
+}
+
+// Fill out a snapshot of the allocator's state and counters
+void mem_stats(mem_stats_t *out) {
+     if (!out)
+         return;
+     memset(out, 0, sizeof(*out));
+     stats_fill(&default_pool, out, 1);
+}
+
+// Like mem_stats, but for a handle pool (no thread-cache numbers)
+void mem_stats_from(mem_pool_t *pool, mem_stats_t *out) {
+     if (!out)
+         return;
+     memset(out, 0, sizeof(*out));
+     stats_fill(pool ? pool : &default_pool, out, pool == NULL);
+}
+
+// Copy the default pool's allocation-size histogram
+void mem_size_histogram(unsigned long out[MEM_SIZE_HIST_BUCKETS]) {
+     mem_size_histogram_from(NULL, out);
+}
+
+// Copy a handle pool's allocation-size histogram
+void mem_size_histogram_from(mem_pool_t *pool, unsigned long out[MEM_SIZE_HIST_BUCKETS]) {
+     if (!out)
+         return;
+     mem_pool_t *p = pool ? pool : &default_pool;
+     for (int i = 0; i < MEM_SIZE_HIST_BUCKETS; ++i)
+         out[i] = __atomic_load_n(&p->size_hist[i], __ATOMIC_RELAXED);
+}
+
+// ----- Pool snapshot / restore -------------------------------------------
+// A snapshot file holds one header, one record per block (in chain
+// order, which for a single segment is ascending offset order), then
+// the raw pool contents. Block metadata is all offsets, so it restores
+// anywhere; raw pointers the application stored inside the pool (list
+// nodes, for one) only stay valid if the restore lands the segment back
+// on its old base address, which mem_restore tries first.
+
+#define SNAP_MAGIC   0x4C4F4F504D454DULL  // "MEMPOOL" little-endian
+#define SNAP_VERSION 1
+
+typedef struct {
+     uint64_t magic;       // SNAP_MAGIC
+     uint32_t version;     // SNAP_VERSION
+     uint32_t use_mmap;    // The pool's backing mode at snapshot time
+     uint64_t pool_size;   // Bytes in the (single) segment
+     uint64_t virt_start;  // The segment's start in the offset space
+     uint64_t next_virt;   // Where the offset space continues after it
+     uint64_t base;        // The segment's address at snapshot time
+     uint64_t block_count; // How many block records follow
+} SnapHeader;
+
+typedef struct {
+     uint64_t offset;      // MemBlock.offset
+     uint64_t size;        // MemBlock.size
+     uint32_t is_free;     // MemBlock.is_free
+     uint32_t pad;         // Keeps the record size stable across builds
+} SnapBlock;
+
+// Write the default pool (contents plus block metadata) to a file
+int mem_snapshot(const char *path) {
+     mem_pool_t *p = &default_pool;
+     LOCK(p);
+
+     // Step 1: Only a single-segment pool snapshots cleanly; with grown
+     // segments the offset space has holes a restore cannot rebuild
+     if (!p->segments || p->segments->next) {
+         UNLOCK(p);
+         fprintf(stderr, "mem_snapshot: pool must have exactly one segment\n");
+         return -1;
+     }
+     PoolSegment *seg = p->segments;
+
+     FILE *f = fopen(path, "wb");
+     if (!f) {
+         UNLOCK(p);
+         fprintf(stderr, "mem_snapshot: cannot open %s (%s)\n", path, strerror(errno));
+         return -1;
+     }
+
+     // Step 2: Header first, counting the blocks on the way
+     SnapHeader hdr = {0};
+     hdr.magic      = SNAP_MAGIC;
+     hdr.version    = SNAP_VERSION;
+     hdr.use_mmap   = (uint32_t)p->use_mmap;
+     hdr.pool_size  = seg->size;
+     hdr.virt_start = seg->virt_start;
+     hdr.next_virt  = p->next_virt;
+     hdr.base       = (uint64_t)(uintptr_t)seg->base;
+     for (MemBlock *b = p->block_list; b; b = b->next)
+         ++hdr.block_count;
+     fwrite(&hdr, sizeof(hdr), 1, f);
+
+     // Step 3: One record per block, in chain order
+     for (MemBlock *b = p->block_list; b; b = b->next) {
+         SnapBlock rec = { b->offset, b->size, (uint32_t)b->is_free, 0 };
+         fwrite(&rec, sizeof(rec), 1, f);
+     }
+
+     // Step 4: The pool contents, verbatim
+     fwrite(seg->base, 1, seg->size, f);
+     UNLOCK(p);
+
+     if (ferror(f)) {
+         fclose(f);
+         fprintf(stderr, "mem_snapshot: write to %s failed\n", path);
+         return -1;
+     }
+     return fclose(f) == 0 ? 0 : -1;
+}
+
+// Rebuild the default pool from a snapshot file; call instead of
+// mem_init. Returns 0 when the segment landed back on its old address
+// (every pointer into the pool is valid again), 1 when it had to be
+// relocated (offsets are still good, stored raw pointers are not)
+int mem_restore(const char *path) {
+     mem_pool_t *p = &default_pool;
+
+     // Step 1: Read and sanity-check the header
+     FILE *f = fopen(path, "rb");
+     if (!f) {
+         fprintf(stderr, "mem_restore: cannot open %s (%s)\n", path, strerror(errno));
+         return -1;
+     }
+     SnapHeader hdr;
+     if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+         hdr.magic != SNAP_MAGIC || hdr.version != SNAP_VERSION) {
+         fclose(f);
+         fprintf(stderr, "mem_restore: %s is not a pool snapshot\n", path);
+         return -1;
+     }
+
+     LOCK(p);
+     if (p->segments) {
+         UNLOCK(p);
+         fclose(f);
+         fprintf(stderr, "mem_restore: pool is already initialized\n");
+         return -1;
+     }
+
+     // Step 2: The offset hash, sized exactly like pool_setup sizes it
+     size_t buckets = 64;
+     while (buckets < hdr.pool_size / 32)
+         buckets <<= 1;
+     p->offset_table = calloc(buckets, sizeof(MemBlock *));
+     if (!p->offset_table) {
+         UNLOCK(p);
+         fclose(f);
+         return -1;
+     }
+     p->offset_buckets = buckets;
+
+     // Step 3: Map the segment, aiming for its old address so raw
+     // pointers the application kept inside the pool come back to life
+     char *base = MAP_FAILED;
+#ifdef MAP_FIXED_NOREPLACE
+     base = mmap((void *)(uintptr_t)hdr.base, hdr.pool_size,
+                 PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+#endif
+     if (base == MAP_FAILED)
+         base = mmap((void *)(uintptr_t)hdr.base, hdr.pool_size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+     if (base == MAP_FAILED) {
+         free(p->offset_table);
+         p->offset_table = NULL;
+         p->offset_buckets = 0;
+         UNLOCK(p);
+         fclose(f);
+         fprintf(stderr, "mem_restore: mmap failed (%s)\n", strerror(errno));
+         return -1;
+     }
+     int relocated = (uint64_t)(uintptr_t)base != hdr.base;
+     if (relocated)
+         fprintf(stderr, "mem_restore: segment relocated; pointers stored "
+                         "inside the pool are stale (offsets are fine)\n");
+
+     PoolSegment *seg = malloc(sizeof(PoolSegment));
+     if (!seg) {
+         munmap(base, hdr.pool_size);
+         free(p->offset_table);
+         p->offset_table = NULL;
+         p->offset_buckets = 0;
+         UNLOCK(p);
+         fclose(f);
+         return -1;
+     }
+     seg->next       = NULL;
+     seg->base       = base;
+     seg->virt_start = hdr.virt_start;
+     seg->size       = hdr.pool_size;
+     seg->dirty_end  = hdr.pool_size; // Restored contents count as dirty
+     seg->is_mmap    = 1;             // The restored segment is always a mapping
+     p->segments     = seg;
+     p->next_virt    = hdr.next_virt;
+     p->pool_size    = hdr.pool_size;
+     p->grow_quantum = hdr.pool_size;
+     p->use_mmap     = (int)hdr.use_mmap;
+
+     // Step 4: Rebuild the block chain and its indexes, record by record
+     MemBlock *tail = NULL;
+     for (uint64_t i = 0; i < hdr.block_count; ++i) {
+         SnapBlock rec;
+         MemBlock *b;
+         if (fread(&rec, sizeof(rec), 1, f) != 1 || !(b = block_new(p))) {
+             pool_teardown(p);
+             UNLOCK(p);
+             fclose(f);
+             fprintf(stderr, "mem_restore: %s is truncated\n", path);
+             return -1;
+         }
+         b->offset    = rec.offset;
+         b->size      = rec.size;
+         b->is_free   = (int)rec.is_free;
+         b->seg       = seg;
+         b->next      = NULL;
+         b->prev      = tail;
+         b->next_free = NULL;
+         b->prev_free = NULL;
+         b->hash_next = NULL;
+         if (tail)
+             tail->next = b;
+         else
+             p->block_list = b;
+         tail = b;
+         hash_insert(p, b);
+         if (b->is_free)
+             free_insert(p, b);
+     }
+
+     // Step 5: Read the pool contents back into place
+     if (fread(base, 1, hdr.pool_size, f) != hdr.pool_size) {
+         pool_teardown(p);
+         UNLOCK(p);
+         fclose(f);
+         fprintf(stderr, "mem_restore: %s is truncated\n", path);
+         return -1;
+     }
+     UNLOCK(p);
+     fclose(f);
+     return relocated ? 1 : 0;
+}
+
+// Translate a pointer into the default pool to its stable pool offset
+size_t mem_offset_of(void *ptr) {
+     mem_pool_t *p = &default_pool;
+     LOCK(p);
+     PoolSegment *seg = segment_of(p, ptr);
+     size_t offset = seg ? seg->virt_start + ((char *)ptr - seg->base)
+                         : (size_t)-1;
+     UNLOCK(p);
+     return offset;
+}
+
+// Translate a stable pool offset back to a pointer, post-restore
+void *mem_ptr_at(size_t offset) {
+     mem_pool_t *p = &default_pool;
+     LOCK(p);
+     void *ptr = NULL;
+     for (PoolSegment *seg = p->segments; seg; seg = seg->next) {
+         if (offset >= seg->virt_start && offset < seg->virt_start + seg->size) {
+             ptr = seg->base + (offset - seg->virt_start);
+             break;
+         }
+     }
+     UNLOCK(p);
+     return ptr;
+}
+
 // Free everything and reset the memory manager
 void mem_deinit() {
-     LOCK();
- 
-     // Step 1: Free the memory pool
-     free(memory_pool);
-     memory_pool = NULL;
-     pool_size   = 0;
- 
-     // Step 2: Free all the metadata blocks
-     MemBlock *curr = block_list;
-     while (curr) {
-         MemBlock *next = curr->next;
-         free(curr);
-         curr = next;
-     }
-     block_list = NULL;
- 
-     UNLOCK();
+     mem_pool_t *p = &default_pool;
+     LOCK(p);
+
+     // Step 1: Free the pool's segments, metadata and hash; with
+     // MEM_HIST_DUMP set in the environment, the size histogram goes to
+     // stderr first so a run's allocation mix can be eyeballed
+     if (getenv("MEM_HIST_DUMP"))
+         hist_dump(p);
+     memset(p->size_hist, 0, sizeof(p->size_hist));
+     pool_teardown(p);
+
+     // Step 2: Drop all thread-cache state; it points into the dead pool
+     cache_drop_all();
+
+     UNLOCK(p);
 }
@@ -18,6 +18,16 @@ extern "C"
      */
     void mem_init(size_t size);
 
+    /**
+     * Initializes the memory manager like mem_init, but reserves the pool
+     * with mmap instead of malloc. Pages are committed lazily on first touch,
+     * so a large pool starts out using almost no resident memory, and large
+     * freed ranges are returned to the operating system.
+     *
+     * @param size The size of the memory pool to initialize.
+     */
+    void mem_init_mmap(size_t size);
+
     /**
      * Allocates a block of memory of the specified size. This function finds a
      * suitable block in the pool, marks it as allocated, and returns a pointer
@@ -28,6 +38,88 @@ extern "C"
      */
     void *mem_alloc(size_t size);
 
+    /**
+     * Controls whether the pool may grow on demand. When enabled, an
+     * allocation that does not fit adds a new segment to the pool instead of
+     * failing, and segments that become entirely free are released again.
+     * Disabled by default, so a fixed-size pool fails exhausted allocations
+     * exactly as before.
+     *
+     * @param enable Non-zero to allow the pool to grow, zero to forbid it.
+     */
+    void mem_set_auto_grow(int enable);
+
+    /**
+     * Switches the pool between eager coalescing — every mem_free
+     * merges its neighbors on the spot, the default — and lazy
+     * coalescing, where frees just rejoin their size class and whole
+     * free runs are merged in one linear sweep instead. The sweep runs
+     * by itself after enough deferred frees, when an allocation would
+     * otherwise fail, or on demand via mem_compact; this takes the
+     * merging work off the latency-critical free path. Turning the
+     * mode off sweeps once so nothing is left unmerged.
+     *
+     * @param enable Non-zero for lazy coalescing, zero for eager.
+     */
+    void mem_set_lazy_coalesce(int enable);
+
+    /**
+     * Merges every run of adjacent free blocks in one pass. Mostly
+     * useful between workload phases when lazy coalescing is enabled;
+     * with eager coalescing the pool is already merged and the call is
+     * a cheap no-op.
+     *
+     * @return How many blocks were merged away.
+     */
+    size_t mem_compact(void);
+
+    /**
+     * Allocates a block of memory of the specified size whose start address is
+     * a multiple of align. Useful for cache-line or SIMD-aligned structures.
+     * Any padding needed in front of the block stays available to other
+     * allocations.
+     *
+     * @param size The size of the memory block to allocate.
+     * @param align The required alignment in bytes; must be a power of two.
+     * @return A pointer to the aligned memory block, or NULL if allocation fails.
+     */
+    void *mem_alloc_aligned(size_t size, size_t align);
+
+    /**
+     * Allocates a zero-filled block for an array of nmemb elements of
+     * the given size, like calloc. Blocks carved out of pages the pool
+     * has never written to (fresh mmap pages, or large freed ranges
+     * already handed back with madvise) are known to be zero, so the
+     * usual memset is skipped for them.
+     *
+     * @param nmemb How many elements the array holds.
+     * @param size The size of each element in bytes.
+     * @return A pointer to the zeroed memory block, or NULL if allocation fails.
+     */
+    void *mem_calloc(size_t nmemb, size_t size);
+
+    /**
+     * Allocates count blocks of the same size in one go, taking the internal
+     * lock only once for the whole batch. The batch is satisfied from as few
+     * contiguous regions as the pool allows. Either the whole batch succeeds
+     * or nothing is allocated.
+     *
+     * @param size The size of each memory block to allocate.
+     * @param count How many blocks to allocate.
+     * @param out Array of at least count entries receiving the pointers.
+     * @return count on success, 0 if the batch could not be satisfied.
+     */
+    size_t mem_alloc_batch(size_t size, size_t count, void **out);
+
+    /**
+     * Frees count blocks in one go, taking the internal lock only once and
+     * coalescing neighbors in the same pass. NULL entries are skipped.
+     *
+     * @param ptrs Array of count pointers previously returned by the allocator.
+     * @param count How many pointers the array holds.
+     */
+    void mem_free_batch(void **ptrs, size_t count);
+
     /**
      * Frees the specified block of memory. This function marks the block as free
      * within the memory manager's data structure.
@@ -46,6 +138,216 @@ extern "C"
      */
     void *mem_resize(void *block, size_t size);
 
+    /**
+     * A snapshot of the allocator's state and counters, filled in by
+     * mem_stats.
+     */
+    typedef struct mem_stats_t
+    {
+        size_t pool_size;             // Total bytes across all pool segments
+        size_t used_bytes;            // Bytes currently allocated
+        size_t free_bytes;            // Bytes currently free
+        size_t largest_free;          // Size of the biggest free block
+        size_t block_count;           // Number of blocks (free and used)
+        size_t segment_count;         // Number of pool segments
+        unsigned long alloc_count;    // Allocations served by the pool
+        unsigned long free_count;     // Frees that reached the pool
+        unsigned long resize_count;   // mem_resize calls
+        unsigned long failed_allocs;  // Allocations that returned NULL
+        unsigned long cache_hits;     // Allocations served by a thread cache
+        unsigned long cache_misses;   // Cacheable allocations that hit the pool
+        unsigned long cache_frees;    // Frees absorbed by a thread cache
+        unsigned long lock_contention; // Times the global lock had to be waited on
+    } mem_stats_t;
+
+    /**
+     * Fills out a snapshot of the allocator: bytes in use, free bytes, the
+     * largest free block, block and segment counts, operation counters,
+     * failed allocations, thread-cache hit numbers, and how often the global
+     * lock was contended. Meant for production diagnostics and tuning.
+     *
+     * @param out Where the snapshot is written. Does nothing if NULL.
+     */
+    void mem_stats(mem_stats_t *out);
+
+    /**
+     * Buckets in the allocation-size histogram: bucket i counts requests
+     * with 2^(i-1) < size <= 2^i (bucket 0 counts size <= 1).
+     */
+#define MEM_SIZE_HIST_BUCKETS 32
+
+    /**
+     * Copies the power-of-two histogram of sizes requested from
+     * mem_alloc, mem_alloc_batch and mem_resize since mem_init. Useful
+     * for checking what the pool actually serves before tuning size
+     * classes. Setting MEM_HIST_DUMP in the environment also prints the
+     * histogram to stderr at mem_deinit.
+     *
+     * @param out Array receiving one count per bucket.
+     */
+    void mem_size_histogram(unsigned long out[MEM_SIZE_HIST_BUCKETS]);
+
+    /**
+     * An independent memory pool with its own lock, block bookkeeping
+     * and statistics. The global mem_* functions operate on a built-in
+     * default pool; handles let each subsystem have a pool of its own,
+     * so they stop sharing one contention domain and one lifetime.
+     */
+    typedef struct mem_pool mem_pool_t;
+
+    /**
+     * Creates an independent memory pool of the specified size. The pool
+     * has its own lock, so allocations from it never contend with the
+     * default pool or with other handle pools.
+     *
+     * @param size The size of the pool to create.
+     * @return The new pool, or NULL if it could not be created.
+     */
+    mem_pool_t *mem_pool_create(size_t size);
+
+    /**
+     * Destroys a pool and releases all of its memory in one go,
+     * regardless of how many blocks are still allocated from it. Any
+     * pointer obtained from the pool is invalid afterwards.
+     *
+     * @param pool The pool to destroy. Does nothing if NULL.
+     */
+    void mem_pool_destroy(mem_pool_t *pool);
+
+    /**
+     * Controls on-demand growth for a handle pool, like
+     * mem_set_auto_grow does for the default pool.
+     *
+     * @param pool The pool to configure.
+     * @param enable Non-zero to allow the pool to grow, zero to forbid it.
+     */
+    void mem_pool_set_auto_grow(mem_pool_t *pool, int enable);
+
+    /**
+     * Like mem_set_lazy_coalesce, but for a handle pool. A NULL pool
+     * configures the default pool.
+     *
+     * @param pool The pool to configure.
+     * @param enable Non-zero for lazy coalescing, zero for eager.
+     */
+    void mem_pool_set_lazy_coalesce(mem_pool_t *pool, int enable);
+
+    /**
+     * Like mem_compact, but sweeps the given pool. A NULL pool sweeps
+     * the default pool.
+     *
+     * @param pool The pool to compact.
+     * @return How many blocks were merged away.
+     */
+    size_t mem_compact_from(mem_pool_t *pool);
+
+    /**
+     * Like mem_alloc, but carves the block out of the given pool. A NULL
+     * pool falls back to the default pool, so callers can treat the pool
+     * handle as optional.
+     *
+     * @param pool The pool to allocate from.
+     * @param size The size of the memory block to allocate.
+     * @return A pointer to the allocated memory block, or NULL if allocation fails.
+     */
+    void *mem_alloc_from(mem_pool_t *pool, size_t size);
+
+    /**
+     * Like mem_alloc_batch, but against the given pool.
+     *
+     * @param pool The pool to allocate from.
+     * @param size The size of each memory block to allocate.
+     * @param count How many blocks to allocate.
+     * @param out Array of at least count entries receiving the pointers.
+     * @return count on success, 0 if the batch could not be satisfied.
+     */
+    size_t mem_alloc_batch_from(mem_pool_t *pool, size_t size, size_t count, void **out);
+
+    /**
+     * Like mem_free, but the block must have come from the given pool.
+     *
+     * @param pool The pool the block belongs to.
+     * @param block A pointer to the memory block to free.
+     */
+    void mem_free_from(mem_pool_t *pool, void *block);
+
+    /**
+     * Like mem_resize, but the block must have come from the given pool
+     * and any replacement block is carved from it too.
+     *
+     * @param pool The pool the block belongs to.
+     * @param block A pointer to the memory block to resize.
+     * @param size The new size of the memory block.
+     * @return A pointer to the resized memory block, or NULL if the resizing fails.
+     */
+    void *mem_resize_from(mem_pool_t *pool, void *block, size_t size);
+
+    /**
+     * Like mem_stats, but snapshots the given pool. The thread-cache
+     * counters stay zero; the caches only front the default pool.
+     *
+     * @param pool The pool to snapshot.
+     * @param out Where the snapshot is written. Does nothing if NULL.
+     */
+    void mem_stats_from(mem_pool_t *pool, mem_stats_t *out);
+
+    /**
+     * Like mem_size_histogram, but for a handle pool. A NULL pool reads
+     * the default pool.
+     *
+     * @param pool The pool whose histogram is copied.
+     * @param out Array receiving one count per bucket.
+     */
+    void mem_size_histogram_from(mem_pool_t *pool, unsigned long out[MEM_SIZE_HIST_BUCKETS]);
+
+    /**
+     * Writes the default pool — its contents plus all block metadata —
+     * to a snapshot file, so a later process can pick the heap up with
+     * mem_restore instead of rebuilding it. Only a single-segment pool
+     * (no grown segments) can be snapshotted. Block metadata is stored
+     * as pool offsets, so it is fully relocatable; raw pointers the
+     * application kept inside the pool are only revived if the restore
+     * lands on the same base address.
+     *
+     * @param path Where the snapshot file is written.
+     * @return 0 on success, -1 on failure.
+     */
+    int mem_snapshot(const char *path);
+
+    /**
+     * Rebuilds the default pool from a snapshot file; call this instead
+     * of mem_init for a warm restart. The pool segment is mapped back
+     * at its old address when the address range is still available, so
+     * pointers into the pool (including linked-list nodes) stay valid.
+     * Only a pool from mem_init_mmap can land on its old address; a
+     * malloc-backed pool's base is not page-aligned and always restores
+     * relocated.
+     *
+     * @param path The snapshot file written by mem_snapshot.
+     * @return 0 when restored at the original address, 1 when the pool
+     *         had to be relocated (offsets remain valid, stored raw
+     *         pointers do not), -1 on failure.
+     */
+    int mem_restore(const char *path);
+
+    /**
+     * Translates a pointer into the default pool to its stable pool
+     * offset, which survives snapshot and restore.
+     *
+     * @param ptr A pointer into the pool.
+     * @return The pool offset, or (size_t)-1 if ptr is not in the pool.
+     */
+    size_t mem_offset_of(void *ptr);
+
+    /**
+     * Translates a stable pool offset back to a live pointer, typically
+     * after mem_restore.
+     *
+     * @param offset A pool offset from mem_offset_of.
+     * @return The pointer it names, or NULL if no segment covers it.
+     */
+    void *mem_ptr_at(size_t offset);
+
     /**
      * Frees up the entire memory pool that was initially allocated by mem_init.
      * This function should be called to clean up the memory manager resources before